@@ -1,135 +1,791 @@
 #include "App.h"
+#include "BlockBVH.h"
+#include "MeshReaders.h"
 
 #include <vtkAbstractPropPicker.h>
+#include <vtkBitArray.h>
+#include <vtkBoundingBox.h>
 #include <vtkCamera.h>
+#include <vtkCellArray.h>
 #include <vtkCellData.h>
+#include <vtkCharArray.h>
 #include <vtkCommand.h>
 #include <vtkCompositeDataDisplayAttributes.h>
 #include <vtkCompositePolyDataMapper2.h>
 #include <vtkConeSource.h>
+#include <vtkCompositeDataSetRange.h>
 #include <vtkCylinderSource.h>
+#include <vtkDataSetSurfaceFilter.h>
+#include <vtkFloatArray.h>
+#include <vtkGlyph3DMapper.h>
 #include <vtkHardwareSelector.h>
+#include <vtkIdTypeArray.h>
 #include <vtkInteractorStyle.h>
 #include <vtkInteractorStyleRubberBandPick.h>
 #include <vtkInteractorStyleSwitch.h>
+#include <vtkMath.h>
+#include <vtkOBJReader.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkPolyDataMapper.h>
 #include <vtkProperty.h>
+#include <vtkRenderStepsPass.h>
 #include <vtkRenderWindow.h>
 #include <vtkRenderedAreaPicker.h>
 #include <vtkRendererCollection.h>
+#include <vtkSMPTools.h>
+#include <vtkSTLReader.h>
 #include <vtkSelectionNode.h>
 #include <vtkSphereSource.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkXMLMultiBlockDataReader.h>
+#include <vtkXMLPolyDataReader.h>
 
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <unordered_set>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/emscripten.h>
+#include <emscripten/heap.h>
+#include <emscripten/html5.h>
+#endif
+#ifdef __EMSCRIPTEN_PTHREADS__
+#include <emscripten/threading.h>
+#endif
+#if defined(__EMSCRIPTEN__) || defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
-BenchmarkApp::BenchmarkApp() { std::cout << __func__ << std::endl; }
+BenchmarkApp::BenchmarkApp() {
+  std::cout << __func__ << std::endl;
+  this->MarkStartup(StartupPhase::Constructed);
+}
 
 BenchmarkApp::~BenchmarkApp() { std::cout << __func__ << std::endl; }
 
 void BenchmarkApp::ClearSelections() {
   std::cout << __func__ << std::endl;
-  // remove coloring from area selections.
-  this->DisplayAttributes->RemoveBlockColors();
+  // the color overrides are set from JS, picks only select cells.
+  this->SelectedCells.Clear();
+  this->UpdateAreaSelectionMesh();
+}
+
+namespace {
+const unsigned char LayerColors[BenchmarkApp::NumLayers][4] = {
+    {190, 33, 40, 255}, {36, 152, 71, 255}, {6, 78, 140, 255}};
+
+// Smallest diameter on screen in pixels of the blocks drawn at every level.
+const double LevelMinPixels[BenchmarkApp::NumLevelsOfDetail] = {64.0, 24.0,
+                                                                0.0};
+#ifndef __EMSCRIPTEN__
+// Delay of scheduled renders on desktop in ms, one frame at 60 Hz.
+const unsigned long VSyncInterval = 16;
+#endif
+// Pause of a drag after which a full quality frame is rendered, in ms.
+const unsigned long RefineDelay = 150;
+
+#ifndef __EMSCRIPTEN__
+// Origin of the startup times on desktop, set while the program is loaded.
+const auto ProgramLoadTime = std::chrono::steady_clock::now();
+#endif
+
+// Time since the origin of the startup times in ms.
+double GetStartupClock() {
+#ifdef __EMSCRIPTEN__
+  // performance.now(), the page measures its own phases with it.
+  return emscripten_get_now();
+#else
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - ::ProgramLoadTime)
+      .count();
+#endif
+}
+
+unsigned char SelectLevelOfDetail(double pixels, unsigned char current) {
+  for (int level = 0; level < BenchmarkApp::NumLevelsOfDetail; ++level) {
+    // a block has to cross a threshold by 15% before it changes level, so
+    // that it does not flicker when its size hovers around the threshold.
+    double threshold = ::LevelMinPixels[level];
+    if (level < current) {
+      threshold *= 1.15;
+    } else if (level == current) {
+      threshold *= 0.85;
+    }
+    if (pixels >= threshold) {
+      return static_cast<unsigned char>(level);
+    }
+  }
+  return BenchmarkApp::NumLevelsOfDetail - 1;
+}
+
+// Interactor events kept by input recordings.
+const unsigned long RecordedEvents[] = {
+    vtkCommand::MouseMoveEvent,          vtkCommand::LeftButtonPressEvent,
+    vtkCommand::LeftButtonReleaseEvent,  vtkCommand::MiddleButtonPressEvent,
+    vtkCommand::MiddleButtonReleaseEvent, vtkCommand::RightButtonPressEvent,
+    vtkCommand::RightButtonReleaseEvent, vtkCommand::MouseWheelForwardEvent,
+    vtkCommand::MouseWheelBackwardEvent, vtkCommand::KeyPressEvent,
+    vtkCommand::KeyReleaseEvent,         vtkCommand::CharEvent,
+    vtkCommand::EnterEvent,              vtkCommand::LeaveEvent,
+    vtkCommand::ConfigureEvent};
+
+// Names of the pick types in recordings, in BenchmarkApp::PickType order.
+const char *PickTypeNames[] = {"area", "hover", "none"};
+
+static_assert(SceneDescription::NumLayers == BenchmarkApp::NumLayers,
+              "scenes describe every layer");
+
+// Tessellates one primitive around the origin.
+vtkSmartPointer<vtkPolyData>
+CreatePrimitive(SceneDescription::Primitive primitive,
+                const std::array<double, 3> &spacings, int resolution) {
+  vtkSmartPointer<vtkPolyDataAlgorithm> source;
+  if (primitive == SceneDescription::Cone) {
+    vtkNew<vtkConeSource> coneSource;
+    coneSource->SetRadius(spacings[0] / 3);
+    coneSource->SetHeight(spacings[1] - 2.0);
+    coneSource->SetResolution(resolution);
+    coneSource->SetOutputPointsPrecision(vtkAlgorithm::SINGLE_PRECISION);
+    source = coneSource;
+  } else if (primitive == SceneDescription::Sphere) {
+    vtkNew<vtkSphereSource> sphereSource;
+    sphereSource->SetRadius(spacings[0] / 3);
+    sphereSource->SetPhiResolution(resolution);
+    sphereSource->SetThetaResolution(resolution);
+    sphereSource->SetOutputPointsPrecision(vtkAlgorithm::SINGLE_PRECISION);
+    source = sphereSource;
+  } else {
+    vtkNew<vtkCylinderSource> cylinderSource;
+    cylinderSource->SetRadius(spacings[0] / 3);
+    cylinderSource->SetHeight(spacings[1] - 2.0);
+    cylinderSource->SetResolution(resolution);
+    cylinderSource->SetOutputPointsPrecision(vtkAlgorithm::SINGLE_PRECISION);
+    source = cylinderSource;
+  }
+  source->Update();
+  vtkSmartPointer<vtkPolyData> primitive = source->GetOutput();
+  // the cell arrays are allocated on first access. do that here, so that
+  // worker threads only ever read the primitive.
+  primitive->GetVerts();
+  primitive->GetLines();
+  primitive->GetPolys();
+  primitive->GetStrips();
+  return primitive;
+}
+
+// FNV-1a over `size` bytes.
+void HashBytes(std::uint64_t &hash, const void *data, std::size_t size) {
+  const auto bytes = static_cast<const unsigned char *>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+}
+
+// Identifies what the blocks of `scene` are generated from: the points and
+// cells of every primitive and the centers of the first instances. It
+// changes with the tessellation or the layout code, so that snapshots of an
+// older build are not taken for the same scene.
+std::uint64_t GeneratorFingerprint(const SceneDescription &scene) {
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+  for (int layer = 0; layer < BenchmarkApp::NumLayers; ++layer) {
+    for (int level = 0; level < BenchmarkApp::NumLevelsOfDetail; ++level) {
+      auto primitive = ::CreatePrimitive(scene.layers[layer], scene.spacing,
+                                         scene.GetResolution(level));
+      auto points =
+          vtkFloatArray::SafeDownCast(primitive->GetPoints()->GetData());
+      ::HashBytes(hash, points->GetPointer(0),
+                  sizeof(float) * 3 * points->GetNumberOfTuples());
+      for (auto cells : {primitive->GetVerts(), primitive->GetLines(),
+                         primitive->GetPolys(), primitive->GetStrips()}) {
+        const vtkIdType sizes[2] = {cells->GetNumberOfCells(),
+                                    cells->GetNumberOfConnectivityIds()};
+        ::HashBytes(hash, sizes, sizeof(sizes));
+      }
+    }
+    float xyz[3 * 8] = {};
+    scene.ComputeCenters(layer, 0,
+                         std::min(scene.GetNumberOfInstances(), 8LL), xyz);
+    ::HashBytes(hash, xyz, sizeof(xyz));
+  }
+  return hash;
+}
+
+// Places a copy of the primitive at `center`. Only the points are new, the
+// cells and point data arrays are shared with the primitive. The color is a
+// block attribute, see BenchmarkApp::ApplyBlockDisplay.
+vtkSmartPointer<vtkPolyData> InstantiatePrimitive(vtkPolyData *primitive,
+                                                  const double center[3]) {
+  auto srcPoints = vtkFloatArray::SafeDownCast(primitive->GetPoints()->GetData());
+  const vtkIdType numPoints = srcPoints->GetNumberOfTuples();
+  vtkNew<vtkFloatArray> dstPoints;
+  dstPoints->SetNumberOfComponents(3);
+  dstPoints->SetNumberOfTuples(numPoints);
+  const float *src = srcPoints->GetPointer(0);
+  float *dst = dstPoints->GetPointer(0);
+  for (vtkIdType i = 0; i < numPoints; ++i) {
+    for (int comp = 0; comp < 3; ++comp) {
+      dst[3 * i + comp] = src[3 * i + comp] + static_cast<float>(center[comp]);
+    }
+  }
+  vtkNew<vtkPoints> points;
+  points->SetData(dstPoints);
+
+  vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+  mesh->SetPoints(points);
+  mesh->SetVerts(primitive->GetVerts());
+  mesh->SetLines(primitive->GetLines());
+  mesh->SetPolys(primitive->GetPolys());
+  mesh->SetStrips(primitive->GetStrips());
+  mesh->GetPointData()->ShallowCopy(primitive->GetPointData());
+  return mesh;
+}
+
+// Places a copy of the points of the primitive, and of their data, at every
+// center. The cells are added for the visible copies only, see
+// BenchmarkApp::BuildMergedLayer.
+void MergePoints(vtkPolyData *primitive, vtkFloatArray *centers,
+                 vtkPolyData *merged) {
+  auto srcPoints =
+      vtkFloatArray::SafeDownCast(primitive->GetPoints()->GetData());
+  const vtkIdType numPoints = srcPoints->GetNumberOfTuples();
+  const vtkIdType numCopies = centers->GetNumberOfTuples();
+  vtkNew<vtkFloatArray> dstPoints;
+  dstPoints->SetNumberOfComponents(3);
+  dstPoints->SetNumberOfTuples(numCopies * numPoints);
+  const float *src = srcPoints->GetPointer(0);
+  const float *xyz = centers->GetPointer(0);
+  float *dst = dstPoints->GetPointer(0);
+  vtkSMPTools::For(0, numCopies, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType copy = begin; copy < end; ++copy) {
+      float *copyDst = dst + 3 * copy * numPoints;
+      for (vtkIdType i = 0; i < 3 * numPoints; ++i) {
+        copyDst[i] = src[i] + xyz[3 * copy + i % 3];
+      }
+    }
+  });
+  vtkNew<vtkPoints> points;
+  points->SetData(dstPoints);
+  merged->SetPoints(points);
+  // normals repeat for every copy.
+  auto srcPointData = primitive->GetPointData();
+  auto dstPointData = merged->GetPointData();
+  dstPointData->CopyAllocate(srcPointData, numCopies * numPoints);
+  for (vtkIdType copy = 0; copy < numCopies; ++copy) {
+    dstPointData->CopyData(srcPointData, copy * numPoints, numPoints, 0);
+  }
 }
+} // namespace
 
 int BenchmarkApp::CreateDatasets(int nx, int ny) {
   std::cout << __func__ << '(' << nx << ',' << ny << ')' << std::endl;
+  return this->CreateScene(SceneDescription::MakeGrid(nx, ny));
+}
+
+int BenchmarkApp::CreateScene(const SceneDescription &scene) {
+  std::cout << __func__ << '(' << scene.name << ')' << std::endl;
+  const auto startTime = std::chrono::steady_clock::now();
+
+  this->ClearScene();
+  if (&scene != &this->Scene) {
+    this->Scene = scene;
+  }
+  this->SceneCreated = true;
+
+  // tessellate every primitive only once per level of detail.
+  const vtkIdType numCells = scene.GetNumberOfInstances();
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    for (int level = 0; level < NumLevelsOfDetail; ++level) {
+      this->Primitives[layer][level] =
+          ::CreatePrimitive(scene.layers[layer], scene.spacing,
+                            scene.GetResolution(level));
+    }
+    this->BlockIdsPerLayer[layer]->SetNumberOfIds(numCells);
+  }
+
+  // one block per layer at every instance of the scene, stacked along Z.
+  vtkSmartPointer<vtkFloatArray> centers[NumLayers];
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    centers[layer] = vtkSmartPointer<vtkFloatArray>::New();
+    centers[layer]->SetNumberOfComponents(3);
+    centers[layer]->SetNumberOfTuples(numCells);
+    float *xyz = centers[layer]->GetPointer(0);
+    vtkSMPTools::For(0, numCells, [&](vtkIdType begin, vtkIdType end) {
+      scene.ComputeCenters(layer, begin, end, xyz);
+      for (vtkIdType cellId = begin; cellId < end; ++cellId) {
+        this->BlockIdsPerLayer[layer]->SetId(cellId,
+                                             cellId * NumLayers + layer);
+      }
+    });
+  }
+  if (this->Strategy != RenderStrategy::Composite) {
+    // one mesh per layer, the instances only carry a position, and a color
+    // for the glyph mapper.
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      vtkNew<vtkPoints> points;
+      points->SetData(centers[layer]);
+      this->Instances[layer]->SetPoints(points);
+      if (this->Strategy == RenderStrategy::Merged) {
+        // the centers only place the merged copies.
+        ::MergePoints(this->Primitives[layer][0], centers[layer],
+                      this->MergedMeshes[layer]);
+        continue;
+      }
+      vtkNew<vtkUnsignedCharArray> colors;
+      colors->SetName("Colors");
+      colors->SetNumberOfComponents(4);
+      colors->SetNumberOfTuples(numCells);
+      for (int comp = 0; comp < 3; ++comp) {
+        colors->FillTypedComponent(comp, ::LayerColors[layer][comp]);
+      }
+      colors->FillTypedComponent(
+          3, static_cast<unsigned char>(this->LayerOpacities[layer] * 255));
+      // hidden instances are masked out by the glyph mapper.
+      vtkNew<vtkBitArray> visibility;
+      visibility->SetName("Visibility");
+      visibility->SetNumberOfTuples(numCells);
+      visibility->FillComponent(0, 1);
+      // index of the source drawn by the glyph mapper.
+      vtkNew<vtkUnsignedCharArray> levels;
+      levels->SetName("LevelOfDetail");
+      levels->SetNumberOfTuples(numCells);
+      levels->FillValue(0);
+      this->Instances[layer]->GetPointData()->SetScalars(colors);
+      this->Instances[layer]->GetPointData()->AddArray(visibility);
+      this->Instances[layer]->GetPointData()->AddArray(levels);
+    }
+  }
+  this->BlockLevels.assign(numCells * NumLayers, 0);
+  this->BlockCulled.clear();
+  this->Attributes.Reset(numCells * NumLayers);
+  // per-block attributes of the scene go through the batch updates, so that
+  // every strategy picks them up.
+  for (const auto &range : scene.blocks) {
+    if (range.hide) {
+      this->Attributes.SetVisibility(range.begin, range.end, false);
+    } else {
+      this->Attributes.SetSceneColor(range.begin, range.end, range.color);
+    }
+  }
+
+  // composite blocks are built from the centers, now or over the next frames.
+  const bool composite = this->Strategy == RenderStrategy::Composite;
+  this->NumberOfInstances = numCells;
+  this->NumberOfBuiltInstances = composite ? 0 : numCells;
+  this->NumberOfStagedInstances = this->NumberOfBuiltInstances;
+  this->ConstructionFrameTime = this->MaxConstructionFrameTime = 0;
+  this->NumberOfConstructionFrames = 0;
+  this->InstanceBuildTime = 0;
+  this->ConstructionStartTime = startTime;
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    this->Centers[layer] = composite ? centers[layer] : nullptr;
+  }
+  if (composite && this->ConstructionBudget > 0) {
+    // culling and levels of detail wait for the bounds of the whole scene.
+    this->BlockBounds.clear();
+    this->BVH.Clear();
+    this->UpdateMappers();
+    return static_cast<int>(numCells * NumLayers);
+  }
+  this->BuildCompositeBlocks(numCells);
+  for (int layer = 0;
+       this->Strategy == RenderStrategy::Merged && layer < NumLayers; ++layer) {
+    this->BuildMergedLayer(layer);
+  }
+  this->FinishConstruction();
+  this->UpdateMappers();
+  return static_cast<int>(numCells * NumLayers);
+}
 
-  // clear previous meshes.
+void BenchmarkApp::ClearScene() {
   this->DisplayAttributes->RemoveBlockColors();
   this->DisplayAttributes->RemoveBlockVisibilities();
   this->Meshes->SetNumberOfPartitionedDataSets(0);
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    this->Instances[layer]->Initialize();
+    this->MergedMeshes[layer]->Initialize();
+    this->MergedInstances[layer].clear();
+    this->MergedCellOffsets[layer].clear();
+  }
+  this->SelectedCells.Clear();
+  this->AreaSelectionMesh->Initialize();
+  this->StagedBlocks.clear();
+  this->MeshSizes.clear();
+  this->MeshSizesRepresentation = -1;
+  // the blocks pointing into a loaded scene cache are gone.
+  this->SceneCacheBuffer.reset();
+}
+
+void BenchmarkApp::BuildCompositeBlocks(vtkIdType end) {
+  const vtkIdType begin = this->NumberOfStagedInstances;
+  end = std::min(end, this->NumberOfInstances);
+  if (end > begin) {
+    // every level of detail of a block is a partition of its partitioned
+    // dataset. only one of them is visible at a time.
+    const vtkIdType firstBlock = begin * NumLayers;
+    const std::size_t firstStaged = this->StagedBlocks.size();
+    this->StagedBlocks.resize(firstStaged + (end - begin) * NumLayers *
+                                                NumLevelsOfDetail);
+    auto blocks = this->StagedBlocks.begin() + firstStaged;
+    vtkSMPTools::For(begin, end, [&](vtkIdType first, vtkIdType last) {
+      for (vtkIdType cellId = first; cellId < last; ++cellId) {
+        for (int layer = 0; layer < NumLayers; ++layer) {
+          const float *xyz = this->Centers[layer]->GetPointer(3 * cellId);
+          const double center[3] = {xyz[0], xyz[1], xyz[2]};
+          const vtkIdType offset = cellId * NumLayers + layer - firstBlock;
+          for (int level = 0; level < NumLevelsOfDetail; ++level) {
+            blocks[offset * NumLevelsOfDetail + level] =
+                ::InstantiatePrimitive(this->Primitives[layer][level], center);
+          }
+        }
+      }
+    });
+    this->NumberOfStagedInstances = end;
+    this->SampleHeapUsage();
+  }
+  // any change of the collection makes the mapper rebuild the buffers of
+  // every block. staged blocks join it once they are as many as the blocks
+  // in it, so the scene is uploaded about twice over the construction
+  // instead of once per chunk.
+  if (this->StagedBlocks.empty() ||
+      (this->NumberOfStagedInstances < this->NumberOfInstances &&
+       this->NumberOfStagedInstances < 2 * this->NumberOfBuiltInstances)) {
+    return;
+  }
+  const vtkIdType firstBlock = this->NumberOfBuiltInstances * NumLayers;
+  const vtkIdType endBlock = this->NumberOfStagedInstances * NumLayers;
+  this->Meshes->SetNumberOfPartitionedDataSets(
+      static_cast<unsigned int>(endBlock));
+  for (vtkIdType blockId = firstBlock; blockId < endBlock; ++blockId) {
+    for (int level = 0; level < NumLevelsOfDetail; ++level) {
+      this->Meshes->SetPartition(
+          static_cast<unsigned int>(blockId), level,
+          this->StagedBlocks[(blockId - firstBlock) * NumLevelsOfDetail +
+                             level]);
+    }
+  }
+  std::vector<vtkSmartPointer<vtkPolyData>>().swap(this->StagedBlocks);
+  this->NumberOfBuiltInstances = this->NumberOfStagedInstances;
+  // hides the coarser levels and colors the blocks by layer.
+  for (vtkIdType blockId = firstBlock; blockId < endBlock; ++blockId) {
+    this->ApplyBlockDisplay(blockId);
+  }
+  this->DisplayAttributes->Modified();
+  this->HoverStyle->InvalidateSelectionBuffers();
+}
+
+void BenchmarkApp::ContinueConstruction() {
+  if (!this->IsConstructionPending()) {
+    return;
+  }
+  const auto startTime = std::chrono::steady_clock::now();
+#ifdef __EMSCRIPTEN__
+  const bool eventLoop = true;
+#else
+  // without an event loop, there are no next frames to spread the work over.
+  const bool eventLoop = this->Interactor->GetInitialized();
+#endif
+  vtkIdType end = this->NumberOfInstances;
+  if (this->ConstructionBudget > 0 && eventLoop) {
+    // the chunk is sized from the time per instance of the previous one.
+    vtkIdType chunk = 64;
+    if (this->InstanceBuildTime > 0) {
+      chunk = std::max<vtkIdType>(
+          static_cast<vtkIdType>(this->ConstructionBudget /
+                                 this->InstanceBuildTime),
+          1);
+    }
+    end = std::min(end, this->NumberOfStagedInstances + chunk);
+  }
+  const vtkIdType begin = this->NumberOfStagedInstances;
+  this->BuildCompositeBlocks(end);
+  this->InstanceBuildTime = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - startTime)
+                                .count() /
+                            std::max<vtkIdType>(end - begin, 1);
+  if (this->IsConstructionPending()) {
+    // the next chunk is built before the next frame.
+    this->RequestRender();
+  } else {
+    this->FinishConstruction();
+  }
+}
+
+void BenchmarkApp::FinishConstruction() {
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    this->Centers[layer] = nullptr;
+  }
+  const vtkIdType numBlocks = this->NumberOfInstances * NumLayers;
+  this->DatasetsGenerationTime =
+      std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - this->ConstructionStartTime)
+          .count();
+  std::cout << "Created " << numBlocks << " objects in "
+            << this->DatasetsGenerationTime << "ms using "
+            << vtkSMPTools::GetEstimatedNumberOfThreads() << " threads ("
+            << vtkSMPTools::GetBackend() << ")" << std::endl;
+  this->UpdateBlockBounds();
+  this->UpdateDatasetsMemoryStats();
+  this->MarkStartup(StartupPhase::SceneReady);
+}
+
+void BenchmarkApp::SetConstructionBudget(double budget) {
+  std::cout << __func__ << "(" << budget << ")" << std::endl;
+  this->ConstructionBudget = budget;
+}
+
+double BenchmarkApp::GetConstructionProgress() {
+  return this->NumberOfInstances > 0
+             ? static_cast<double>(this->NumberOfStagedInstances) /
+                   this->NumberOfInstances
+             : 1.0;
+}
+
+bool BenchmarkApp::IsConstructionPending() {
+  return this->NumberOfBuiltInstances < this->NumberOfInstances;
+}
+
+double BenchmarkApp::GetConstructionFrameTime() {
+  return this->NumberOfConstructionFrames > 0
+             ? this->ConstructionFrameTime / this->NumberOfConstructionFrames
+             : 0.0;
+}
+
+void BenchmarkApp::AddConstructionFrame(double frameTime) {
+  this->ConstructionFrameTime += frameTime;
+  this->MaxConstructionFrameTime =
+      std::max(this->MaxConstructionFrameTime, frameTime);
+  ++this->NumberOfConstructionFrames;
+  if (!this->IsConstructionPending()) {
+    std::cout << "Rendered " << this->NumberOfConstructionFrames
+              << " frames while building the scene, "
+              << this->GetConstructionFrameTime() << "ms on average and "
+              << this->MaxConstructionFrameTime << "ms at most" << std::endl;
+  }
+}
+
+void BenchmarkApp::UpdateBlockBounds() {
+  const auto startTime = std::chrono::steady_clock::now();
+  // block ids are partition indices. instanced and merged blocks follow the
+  // same numbering, see CreateDatasets.
+  vtkIdType numBlocks = this->Meshes->GetNumberOfPartitionedDataSets();
+  const bool composite = this->Strategy == RenderStrategy::Composite;
+  if (!composite) {
+    numBlocks = NumLayers * this->Instances[0]->GetNumberOfPoints();
+  }
+  this->BlockBounds.resize(numBlocks);
+  // GetBounds may compute and cache the bounds, never call it from threads.
+  std::array<BlockBVH::Bounds, NumLayers> primitiveBounds;
+  for (int layer = 0; layer < NumLayers && !composite; ++layer) {
+    this->Primitives[layer][0]->GetBounds(primitiveBounds[layer].data());
+  }
+  vtkSMPTools::For(0, numBlocks, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType blockId = begin; blockId < end; ++blockId) {
+      auto &bounds = this->BlockBounds[blockId];
+      if (!composite) {
+        const int layer = blockId % NumLayers;
+        double center[3];
+        this->Instances[layer]->GetPoint(blockId / NumLayers, center);
+        bounds = primitiveBounds[layer];
+        for (int i = 0; i < 6; ++i) {
+          bounds[i] += center[i / 2];
+        }
+      } else if (auto mesh = vtkDataSet::SafeDownCast(this->Meshes->GetPartition(
+                     static_cast<unsigned int>(blockId), 0))) {
+        mesh->GetBounds(bounds.data());
+      } else {
+        vtkMath::UninitializeBounds(bounds.data());
+      }
+    }
+  });
+  this->BVH.Build(this->BlockBounds);
+  std::cout << "Built bounding volume hierarchy over " << numBlocks
+            << " blocks in "
+            << std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - startTime)
+                   .count()
+            << "ms" << std::endl;
+}
+
+void BenchmarkApp::UpdateMappers() {
+  this->HoverStyle->InvalidateSelectionBuffers();
+  if (this->Strategy == RenderStrategy::Instanced) {
+    this->HoverStyle->SetDatasets(nullptr);
+    this->HoverStyle->RemoveAllInstancedActors();
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      vtkNew<vtkGlyph3DMapper> mapper;
+      for (int level = 0; level < NumLevelsOfDetail; ++level) {
+        mapper->SetSourceData(level, this->Primitives[layer][level]);
+      }
+      mapper->SourceIndexingOn();
+      mapper->SetSourceIndexArray("LevelOfDetail");
+      mapper->SetInputData(this->Instances[layer]);
+      // instances are only translated.
+      mapper->ScalingOff();
+      mapper->OrientOff();
+      mapper->SetScalarModeToUsePointData();
+      mapper->SetColorModeToDirectScalars();
+      mapper->MaskingOn();
+      mapper->SetMaskArray("Visibility");
+      this->InstancedActors[layer]->SetMapper(mapper);
+      this->InstancedActors[layer]->SetProperty(this->Actor->GetProperty());
+      this->HoverStyle->AddInstancedActor(this->InstancedActors[layer],
+                                          this->Primitives[layer][0],
+                                          this->Instances[layer]->GetPoints());
+      this->MergedActors[layer]->SetMapper(nullptr);
+    }
+    this->Actor->SetMapper(nullptr);
+  } else if (this->Strategy == RenderStrategy::Merged) {
+    this->HoverStyle->SetDatasets(nullptr);
+    this->HoverStyle->RemoveAllInstancedActors();
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      vtkNew<vtkPolyDataMapper> mapper;
+      mapper->SetScalarModeToUseCellData();
+      mapper->SetInputData(this->MergedMeshes[layer]);
+      this->MergedActors[layer]->SetMapper(mapper);
+      this->MergedActors[layer]->SetProperty(this->Actor->GetProperty());
+      this->HoverStyle->AddMergedActor(
+          this->MergedActors[layer], this->Primitives[layer][0],
+          this->Instances[layer]->GetPoints(),
+          this->MergedCellInstanceIds[layer]);
+      this->InstancedActors[layer]->SetMapper(nullptr);
+    }
+    this->Actor->SetMapper(nullptr);
+  } else {
+    this->HoverStyle->SetDatasets(this->Meshes);
+    this->HoverStyle->RemoveAllInstancedActors();
+    vtkSmartPointer<vtkCompositePolyDataMapper2> mapper =
+        vtkSmartPointer<vtkCompositePolyDataMapper2>::New();
+    mapper->SetCompositeDataDisplayAttributes(this->DisplayAttributes);
+    mapper->SetScalarModeToUseCellData();
+    mapper->SetInputDataObject(this->Meshes);
+    this->Actor->SetMapper(mapper);
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      this->InstancedActors[layer]->SetMapper(nullptr);
+      this->MergedActors[layer]->SetMapper(nullptr);
+    }
+  }
+  for (const auto &view : this->Views) {
+    this->AddActors(view);
+  }
+}
+
+void BenchmarkApp::AddActors(vtkRenderer *ren) {
+  // only the actors of the current strategy are in the renderer.
+  auto show = [ren](vtkActor *actor, bool visible) {
+    if (!visible) {
+      ren->RemoveActor(actor);
+    } else if (!ren->HasViewProp(actor)) {
+      ren->AddActor(actor);
+    }
+  };
+  show(this->Actor, this->Strategy == RenderStrategy::Composite);
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    show(this->InstancedActors[layer],
+         this->Strategy == RenderStrategy::Instanced);
+    show(this->MergedActors[layer], this->Strategy == RenderStrategy::Merged);
+  }
+  show(this->AreaSelectionActor, true);
+}
+
+void BenchmarkApp::SetRenderStrategy(RenderStrategy strategy) {
+  std::cout << __func__ << "("
+            << (strategy == RenderStrategy::Instanced
+                    ? "Instanced"
+                    : (strategy == RenderStrategy::Merged ? "Merged"
+                                                          : "Composite"))
+            << ")" << std::endl;
+  if (strategy == this->Strategy) {
+    return;
+  }
+  this->Strategy = strategy;
+  if (this->SceneCreated) {
+    this->CreateScene(this->Scene);
+  }
+}
 
-  vtkNew<vtkConeSource> coneSource;
-  vtkNew<vtkSphereSource> sphereSource;
-  vtkNew<vtkCylinderSource> cylinderSource;
-
-  unsigned char coneColor[4] = {190, 33, 40, 255};
-  unsigned char sphereColor[4] = {36, 152, 71, 255};
-  unsigned char cylinderColor[4] = {6, 78, 140, 255};
-
-  double x = 0, y = 0, z = 0.;
-  int dimensions[2] = {nx, ny};
-  double spacings[3] = {50.0, 50.0, 50.0};
-  int partitionIdx = 0;
-  for (int i = 0, x = 0; i < dimensions[0]; ++i, x += spacings[0]) {
-    for (int j = 0, y = 0; j < dimensions[1]; ++j, y += spacings[1]) {
-      z = 0;
-      coneSource->SetCenter(x, y, z);
-      coneSource->SetRadius(spacings[0] / 3);
-      coneSource->SetHeight(spacings[1] - 2.0);
-      coneSource->SetResolution(16);
-      coneSource->Update();
-      vtkNew<vtkPolyData> cone;
-      cone->DeepCopy(coneSource->GetOutput());
-      vtkNew<vtkUnsignedCharArray> coneColors;
-      coneColors->SetNumberOfComponents(4);
-      coneColors->SetNumberOfTuples(cone->GetNumberOfCells());
-      for (int comp = 0; comp < 4; ++comp) {
-        coneColors->FillTypedComponent(comp, coneColor[comp]);
-      }
-      cone->GetCellData()->SetScalars(coneColors);
-      this->BlockIdsPerLayer[LayerID::Cone]->InsertNextId(partitionIdx);
-      this->Meshes->SetPartition(partitionIdx++, 0, cone);
-      z += spacings[2];
-
-      sphereSource->SetCenter(x, y, z);
-      sphereSource->SetRadius(spacings[0] / 3);
-      sphereSource->SetPhiResolution(16);
-      sphereSource->SetThetaResolution(16);
-      sphereSource->Update();
-      vtkNew<vtkPolyData> sphere;
-      sphere->DeepCopy(sphereSource->GetOutput());
-      vtkNew<vtkUnsignedCharArray> sphereColors;
-      sphereColors->SetNumberOfComponents(4);
-      sphereColors->SetNumberOfTuples(sphere->GetNumberOfCells());
-      for (int comp = 0; comp < 4; ++comp) {
-        sphereColors->FillTypedComponent(comp, sphereColor[comp]);
-      }
-      sphere->GetCellData()->SetScalars(sphereColors);
-      this->BlockIdsPerLayer[LayerID::Sphere]->InsertNextId(partitionIdx);
-      this->Meshes->SetPartition(partitionIdx++, 0, sphere);
-      z += spacings[2];
-
-      cylinderSource->SetCenter(x, y, z);
-      cylinderSource->SetRadius(spacings[0] / 3);
-      cylinderSource->SetHeight(spacings[1] - 2.0);
-      cylinderSource->SetResolution(16);
-      cylinderSource->Update();
-      vtkNew<vtkPolyData> cylinder;
-      cylinder->DeepCopy(cylinderSource->GetOutput());
-      vtkNew<vtkUnsignedCharArray> cylinderColors;
-      cylinderColors->SetNumberOfComponents(4);
-      cylinderColors->SetNumberOfTuples(cylinder->GetNumberOfCells());
-      for (int comp = 0; comp < 4; ++comp) {
-        cylinderColors->FillTypedComponent(comp, cylinderColor[comp]);
-      }
-      cylinder->GetCellData()->SetScalars(cylinderColors);
-      this->BlockIdsPerLayer[LayerID::Cylinder]->InsertNextId(partitionIdx);
-      this->Meshes->SetPartition(partitionIdx++, 0, cylinder);
-    }
-  }
-  std::cout << "Created " << this->Meshes->GetNumberOfPartitionedDataSets()
-            << " objects" << std::endl;
-
-  this->HoverStyle->SetDatasets(this->Meshes);
-  vtkSmartPointer<vtkCompositePolyDataMapper2> mapper =
-      vtkSmartPointer<vtkCompositePolyDataMapper2>::New();
-  mapper->SetCompositeDataDisplayAttributes(this->DisplayAttributes);
-  mapper->SetScalarModeToUseCellData();
-  mapper->SetInputDataObject(this->Meshes);
-  this->Actor->SetMapper(mapper);
-  return this->Meshes->GetNumberOfPartitionedDataSets();
+BenchmarkApp::RenderStrategy BenchmarkApp::GetRenderStrategy() {
+  return this->Strategy;
 }
 
 void BenchmarkApp::Initialize() {
   std::cout << __func__ << std::endl;
+#ifdef __EMSCRIPTEN_PTHREADS__
+  // the pool of web workers is created up front, one per logical core.
+  if (!vtkSMPTools::SetBackend("STDThread")) {
+    std::cerr << "VTK was built without the STDThread SMP backend"
+              << std::endl;
+  }
+  vtkSMPTools::Initialize(emscripten_num_logical_cores());
+#endif
+  std::cout << "SMP backend " << this->GetSMPBackend() << " with "
+            << this->GetNumberOfThreads() << " threads" << std::endl;
   // create the default renderer
   vtkNew<vtkRenderer> ren;
+  ren->AddObserver(vtkCommand::StartEvent, this,
+                   &BenchmarkApp::StartViewHandler);
+  ren->AddObserver(vtkCommand::EndEvent, this, &BenchmarkApp::EndViewHandler);
+  this->AddTranslucencyPass(ren);
   this->Window->AddRenderer(ren);
+  this->Views.emplace_back(ren);
   this->Window->SetInteractor(this->Interactor);
   this->Window->SetMultiSamples(0);
+  this->Window->AddObserver(vtkCommand::StartEvent, this,
+                            &BenchmarkApp::StartRenderHandler);
   this->Window->AddObserver(vtkCommand::EndEvent, this,
                             &BenchmarkApp::EndRenderHandler);
+  // the interactor only fires RenderEvent, the render is scheduled.
+  this->Interactor->EnableRenderOff();
+  this->Interactor->AddObserver(vtkCommand::RenderEvent, this,
+                                &BenchmarkApp::RequestRender);
+  this->Interactor->AddObserver(vtkCommand::TimerEvent, this,
+                                &BenchmarkApp::RenderTimerHandler);
+  // hover picks happen in the view under the pointer, camera interactions
+  // go to the view they start in.
+  this->HoverStyle->SetViewLocator(
+      [this](int x, int y) { return this->GetViewAt(x, y); });
+  // recorded, or dropped, before the interactor styles handle them.
+  for (const auto eventId : ::RecordedEvents) {
+    this->Interactor->AddObserver(eventId, this, &BenchmarkApp::InputHandler,
+                                  1.0f);
+  }
+  // selected cells are drawn over the blocks in the selection color.
+  vtkNew<vtkPolyDataMapper> selectionMapper;
+  selectionMapper->SetInputData(this->AreaSelectionMesh);
+  selectionMapper->ScalarVisibilityOff();
+  selectionMapper->SetRelativeCoincidentTopologyPolygonOffsetParameters(-1,
+                                                                        -1);
+  this->AreaSelectionActor->SetMapper(selectionMapper);
+  this->AreaSelectionActor->PickableOff();
+  this->MarkStartup(StartupPhase::Initialized);
+}
+
+bool BenchmarkApp::IsMultithreaded() {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  return false;
+#else
+  return true;
+#endif
+}
+
+std::string BenchmarkApp::GetSMPBackend() {
+  return vtkSMPTools::GetBackend();
+}
+
+int BenchmarkApp::GetNumberOfThreads() {
+  return vtkSMPTools::GetEstimatedNumberOfThreads();
 }
 
 void BenchmarkApp::Render() {
@@ -137,20 +793,197 @@ void BenchmarkApp::Render() {
   this->Window->Render();
 }
 
+void BenchmarkApp::RequestRender() {
+  ++this->NumberOfRenderRequests;
+  if (this->RenderDirty) {
+    ++this->NumberOfCoalescedRenders;
+  }
+  this->RenderDirty = true;
+  // replays render once per step, see StepReplay.
+  if (this->RenderScheduled || this->Replaying) {
+    return;
+  }
+#ifdef __EMSCRIPTEN__
+  this->RenderScheduled = true;
+  emscripten_request_animation_frame(
+      [](double, void *self) -> EM_BOOL {
+        static_cast<BenchmarkApp *>(self)->RenderIfDirty();
+        return EM_FALSE;
+      },
+      this);
+#else
+  if (!this->Interactor->GetInitialized()) {
+    // no event loop, the next explicit Render draws the frame.
+    return;
+  }
+  this->RenderScheduled = true;
+  this->RenderTimerId = this->Interactor->CreateOneShotTimer(::VSyncInterval);
+#endif
+}
+
+void BenchmarkApp::RenderTimerHandler(vtkObject *, unsigned long,
+                                      void *callData) {
+  if (callData != nullptr && this->RenderTimerId >= 0 &&
+      *static_cast<int *>(callData) == this->RenderTimerId) {
+    this->RenderTimerId = -1;
+    this->RenderIfDirty();
+  } else if (callData != nullptr && this->RefineTimerId >= 0 &&
+             *static_cast<int *>(callData) == this->RefineTimerId) {
+    // the camera stopped without the interaction ending.
+    this->RefineTimerId = -1;
+    this->RefineRequested = true;
+    this->RequestRender();
+  }
+}
+
+void BenchmarkApp::RenderIfDirty() {
+  this->RenderScheduled = false;
+  if (this->RenderDirty) {
+    this->Window->Render();
+  } else {
+    // a direct render already drew the scene.
+    ++this->NumberOfSkippedRenders;
+  }
+}
+
+int BenchmarkApp::GetNumberOfRenders() { return this->NumberOfRenders; }
+
+int BenchmarkApp::GetNumberOfRenderRequests() {
+  return this->NumberOfRenderRequests;
+}
+
+int BenchmarkApp::GetNumberOfCoalescedRenders() {
+  return this->NumberOfCoalescedRenders;
+}
+
+int BenchmarkApp::GetNumberOfSkippedRenders() {
+  return this->NumberOfSkippedRenders;
+}
+
 void BenchmarkApp::ResetView() {
+  std::cout << __func__ << std::endl;
+  if (!this->IsConstructionPending()) {
+    for (const auto &view : this->Views) {
+      view->ResetCamera();
+    }
+    this->RecordCamera();
+    return;
+  }
+  // frame the whole scene, not only the blocks built so far.
+  vtkBoundingBox box;
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    double bounds[6];
+    this->Primitives[layer][0]->GetBounds(bounds);
+    for (int axis = 0; axis < 3; ++axis) {
+      double range[2];
+      this->Centers[layer]->GetRange(range, axis);
+      bounds[2 * axis] += range[0];
+      bounds[2 * axis + 1] += range[1];
+    }
+    box.AddBounds(bounds);
+  }
+  double bounds[6];
+  box.GetBounds(bounds);
+  for (const auto &view : this->Views) {
+    view->ResetCamera(bounds);
+  }
+  this->RecordCamera();
+}
+
+void BenchmarkApp::InitializeView() {
   std::cout << __func__ << std::endl;
   auto ren = this->Window->GetRenderers()->GetFirstRenderer();
-  if (ren != nullptr) {
-    ren->ResetCamera();
+  this->AddActors(ren);
+  // start from the same camera every time, so that runs are comparable.
+  auto cam = ren->GetActiveCamera();
+  cam->SetPosition(0.0, 0.0, 1.0);
+  cam->SetFocalPoint(0.0, 0.0, 0.0);
+  cam->SetViewUp(0.0, 1.0, 0.0);
+  cam->SetViewAngle(30.0);
+  ren->ResetCamera();
+  cam->Elevation(30.0);
+  cam->Azimuth(-40.0);
+  cam->Zoom(3.0);
+  cam->Roll(10.0);
+  ren->ResetCamera();
+  for (std::size_t view = 1; view < this->Views.size(); ++view) {
+    this->AddActors(this->Views[view]);
+    this->InitializeViewCamera(static_cast<int>(view));
+  }
+  this->RecordCamera();
+}
+
+void BenchmarkApp::InitializeViewCamera(int view) {
+  // the same model seen from around it, like linked views of a product.
+  auto cam = this->Views[view]->GetActiveCamera();
+  cam->DeepCopy(this->Views[0]->GetActiveCamera());
+  cam->Azimuth(view * 360.0 / this->Views.size());
+  this->Views[view]->ResetCameraClippingRange();
+}
+
+void BenchmarkApp::SetNumberOfViews(int count) {
+  std::cout << __func__ << "(" << count << ")" << std::endl;
+  count = std::max(1, std::min(count, FrameTimer::MaxViews));
+  if (this->Views.empty() ||
+      count == static_cast<int>(this->Views.size())) {
+    return;
+  }
+  while (static_cast<int>(this->Views.size()) > count) {
+    this->Window->RemoveRenderer(this->Views.back());
+    this->Views.pop_back();
+    this->TranslucencyPasses.pop_back();
+  }
+  while (static_cast<int>(this->Views.size()) < count) {
+    vtkNew<vtkRenderer> ren;
+    ren->AddObserver(vtkCommand::StartEvent, this,
+                     &BenchmarkApp::StartViewHandler);
+    ren->AddObserver(vtkCommand::EndEvent, this,
+                     &BenchmarkApp::EndViewHandler);
+    // the actors, and with them the mappers and their buffers, are shared.
+    this->AddActors(ren);
+    this->AddTranslucencyPass(ren);
+    this->Window->AddRenderer(ren);
+    this->Views.emplace_back(ren);
+  }
+  for (int view = 1; view < count; ++view) {
+    this->InitializeViewCamera(view);
+  }
+  this->UpdateViewports();
+  this->HoverStyle->InvalidateSelectionBuffers();
+}
+
+int BenchmarkApp::GetNumberOfViews() {
+  return static_cast<int>(this->Views.size());
+}
+
+void BenchmarkApp::UpdateViewports() {
+  const int count = static_cast<int>(this->Views.size());
+  const int columns = count == 4 ? 2 : count;
+  const int rows = count == 4 ? 2 : 1;
+  for (int view = 0; view < count; ++view) {
+    // the first view is at the top left.
+    const double column = view % columns, row = view / columns;
+    this->Views[view]->SetViewport(
+        column / columns, 1.0 - (row + 1) / rows, (column + 1) / columns,
+        1.0 - row / rows);
   }
 }
 
+vtkRenderer *BenchmarkApp::GetViewAt(int x, int y) {
+  for (const auto &view : this->Views) {
+    if (view->IsInViewport(x, y)) {
+      return view;
+    }
+  }
+  return this->Views.empty() ? nullptr : this->Views[0].Get();
+}
+
+void BenchmarkApp::WaitForCompletion() { this->Window->WaitForCompletion(); }
+
 int BenchmarkApp::Run() {
   std::cout << __func__ << std::endl;
   auto ren = this->Window->GetRenderers()->GetFirstRenderer();
-  if (!ren->HasViewProp(this->Actor)) {
-    ren->AddActor(this->Actor);
-  }
+  this->InitializeView();
 
   // camera orientation widget
   this->CamManipulator->SetParentRenderer(ren);
@@ -160,11 +993,10 @@ int BenchmarkApp::Run() {
   rep->AnchorToLowerLeft();
 
   this->Interactor->UpdateSize(600, 600);
-  ren->GetActiveCamera()->Elevation(30.0);
-  ren->GetActiveCamera()->Azimuth(-40.0);
-  ren->GetActiveCamera()->Zoom(3.0);
-  ren->GetActiveCamera()->Roll(10.0);
-  ren->ResetCamera();
+  this->RecordWindowSize();
+  // with the event loop ready, a pending construction goes on over the next
+  // frames instead of finishing in this render.
+  this->Interactor->Initialize();
   this->Window->Render();
   this->Interactor->Start();
   return 0;
@@ -182,6 +1014,13 @@ void BenchmarkApp::SetPickType(PickType pickType) {
                     : (pickType == PickType::Hover ? "Hover" : "None"))
             << ")" << std::endl;
   auto ren = this->Window->GetRenderers()->GetFirstRenderer();
+  this->CurrentPickType = pickType;
+  if (this->RecordingInput) {
+    InputRecording::Event event;
+    event.kind = InputRecording::Pick;
+    event.pick = ::PickTypeNames[pickType];
+    this->RecordEvent(std::move(event));
+  }
   // Setup picker
   if (pickType == PickType::Area) {
     vtkNew<vtkInteractorStyleRubberBandPick> rbp;
@@ -189,17 +1028,21 @@ void BenchmarkApp::SetPickType(PickType pickType) {
     vtkNew<vtkRenderedAreaPicker> picker;
     this->Interactor->SetPicker(picker);
     // pass pick events to the HardwareSelector
-    auto ren = this->Window->GetRenderers()->GetFirstRenderer();
-    this->Interactor->AddObserver(vtkCommand::EndPickEvent, this,
-                                  &BenchmarkApp::EndPickHandler);
+    if (this->EndPickObserverTag == 0) {
+      this->EndPickObserverTag = this->Interactor->AddObserver(
+          vtkCommand::EndPickEvent, this, &BenchmarkApp::EndPickHandler);
+    }
     rbp->SetMouseWheelMotionFactor(this->ScrollSensitivity);
   } else if (pickType == PickType::Hover) {
+    this->Interactor->RemoveObserver(this->EndPickObserverTag);
+    this->EndPickObserverTag = 0;
     this->Interactor->SetPicker(nullptr);
-    this->HoverStyle->SetDefaultRenderer(ren);
     this->HoverStyle->Activate(ren);
     this->Interactor->SetInteractorStyle(this->HoverStyle);
     this->HoverStyle->SetMouseWheelMotionFactor(this->ScrollSensitivity);
   } else if (pickType == PickType::None) {
+    this->Interactor->RemoveObserver(this->EndPickObserverTag);
+    this->EndPickObserverTag = 0;
     this->HoverStyle->Deactivate(ren);
     this->Interactor->SetPicker(nullptr);
     this->Interactor->SetInteractorStyle(this->SwitchStyle);
@@ -229,120 +1072,2176 @@ void BenchmarkApp::SetLayerVisibility(LayerID layer, bool visible) {
     return;
   }
   auto &blkIds = this->BlockIdsPerLayer[layer];
-  for (auto it = blkIds->begin(); it != blkIds->end(); ++it) {
-    const auto &mesh = this->Meshes->GetPartition(*it, 0);
-    this->DisplayAttributes->SetBlockVisibility(mesh, visible);
-  }
-}
-
-void BenchmarkApp::SetLineWidth(float width) {
-  std::cout << __func__ << "(" << width << ")" << std::endl;
-  this->Actor->GetProperty()->SetLineWidth(width);
+  this->Attributes.SetVisibility(blkIds->GetPointer(0),
+                                 blkIds->GetNumberOfIds(), visible);
 }
 
-void BenchmarkApp::SetPointSize(float size) {
-  std::cout << __func__ << "(" << size << ")" << std::endl;
-  this->Actor->GetProperty()->SetPointSize(size);
+void BenchmarkApp::SetBlocksVisibility(int begin, int end, bool visible) {
+  std::cout << __func__ << "(" << begin << ',' << end << ',' << visible << ")"
+            << std::endl;
+  this->Attributes.SetVisibility(begin, end, visible);
 }
 
-void BenchmarkApp::SetRepresentation(int representation) {
-  std::cout << __func__ << "(" << representation << ")" << std::endl;
-  if (representation > VTK_SURFACE) {
-    // surf with edges
-    this->Actor->GetProperty()->SetEdgeVisibility(true);
-  } else {
-    this->Actor->GetProperty()->SetEdgeVisibility(false);
-  }
-  this->Actor->GetProperty()->SetRepresentation(representation);
+void BenchmarkApp::SetBlocksVisibilityFromBitset(std::uintptr_t bits,
+                                                 int numBlocks, bool visible) {
+  std::cout << __func__ << "(" << numBlocks << ',' << visible << ")"
+            << std::endl;
+  this->Attributes.SetVisibility(reinterpret_cast<const std::uint32_t *>(bits),
+                                 numBlocks, visible);
 }
 
-void BenchmarkApp::SetSelectedBlockColor(float r, float g, float b) {
-  std::cout << __func__ << "(" << r << ',' << g << ',' << b << ")" << std::endl;
-  this->SelectedBlockColor.Set(r, g, b);
+void BenchmarkApp::SetBlocksColor(int begin, int end, float r, float g,
+                                  float b) {
+  std::cout << __func__ << "(" << begin << ',' << end << ',' << r << ',' << g
+            << ',' << b << ")" << std::endl;
+  this->Attributes.SetColor(begin, end, {r, g, b});
 }
 
-CameraState BenchmarkApp::GetCameraState() {
-  auto ren = this->Window->GetRenderers()->GetFirstRenderer();
-  if (ren == nullptr) {
-    return {};
-  }
-  auto cam = ren->GetActiveCamera();
-  CameraState camState;
-  cam->GetViewUp(camState.viewUp);
-  cam->GetPosition(camState.position);
-  cam->GetFocalPoint(camState.focalPoint);
-  camState.viewAngle = cam->GetViewAngle();
-  return camState;
+void BenchmarkApp::SetBlocksColorFromBitset(std::uintptr_t bits, int numBlocks,
+                                            float r, float g, float b) {
+  std::cout << __func__ << "(" << numBlocks << ',' << r << ',' << g << ','
+            << b << ")" << std::endl;
+  this->Attributes.SetColor(reinterpret_cast<const std::uint32_t *>(bits),
+                            numBlocks, {r, g, b});
 }
 
-void BenchmarkApp::SetCameraState(CameraState &state) {
-  auto ren = this->Window->GetRenderers()->GetFirstRenderer();
-  if (ren == nullptr) {
-    return;
-  }
-  auto cam = ren->GetActiveCamera();
-  cam->SetViewUp(state.viewUp);
-  cam->SetPosition(state.position);
-  cam->SetFocalPoint(state.focalPoint);
-  cam->SetViewAngle(state.viewAngle);
-  ren->ResetCameraClippingRange();
+void BenchmarkApp::RemoveBlocksColor(int begin, int end) {
+  std::cout << __func__ << "(" << begin << ',' << end << ")" << std::endl;
+  this->Attributes.RemoveColor(begin, end);
 }
 
-void BenchmarkApp::SetShowCameraManipulator(bool show) {
-  this->CamManipulator->SetEnabled(show);
+int BenchmarkApp::GetNumberOfBlocks() {
+  return static_cast<int>(this->Attributes.GetNumberOfBlocks());
 }
 
-void BenchmarkApp::LoadFileFromBinary(const std::string &contents) {}
-
-void BenchmarkApp::LoadFile(const std::string &filename) {}
-
-// Called after area picker finished.
-void BenchmarkApp::EndPickHandler(vtkObject *, unsigned long, void *) {
-  auto ren = this->Window->GetRenderers()->GetFirstRenderer();
-
-  vtkNew<vtkHardwareSelector> sel;
-  sel->SetFieldAssociation(vtkDataObject::FIELD_ASSOCIATION_CELLS);
-  sel->SetRenderer(ren);
-
-  double x0 = ren->GetPickX1();
-  double y0 = ren->GetPickY1();
-  double x1 = ren->GetPickX2();
-  double y1 = ren->GetPickY2();
-
-  sel->SetArea(static_cast<int>(x0), static_cast<int>(y0), static_cast<int>(x1),
-               static_cast<int>(y1));
-  vtkSmartPointer<vtkSelection> res;
-  res.TakeReference(sel->Select());
-  if (!res) {
-    cerr << "Selection not supported." << endl;
+void BenchmarkApp::FlushBlockAttributes() {
+  const auto &dirtyBlocks = this->Attributes.GetDirtyBlocks();
+  if (dirtyBlocks.empty()) {
     return;
   }
-
-  vtkSelectionNode *cellids = res->GetNode(0);
-  this->DisplayAttributes->RemoveBlockColors();
+  if (this->Attributes.IsVisibilityDirty()) {
+    this->HoverStyle->InvalidateSelectionBuffers();
+  }
+  if (this->Strategy == RenderStrategy::Instanced) {
+    vtkUnsignedCharArray *colors[NumLayers];
+    vtkBitArray *visibilities[NumLayers];
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      auto pointData = this->Instances[layer]->GetPointData();
+      colors[layer] =
+          vtkUnsignedCharArray::SafeDownCast(pointData->GetScalars());
+      visibilities[layer] =
+          vtkBitArray::SafeDownCast(pointData->GetArray("Visibility"));
+    }
+    bool modified[NumLayers] = {};
+    for (const auto &blockId : dirtyBlocks) {
+      const int layer = blockId % NumLayers;
+      const vtkIdType instanceId = blockId / NumLayers;
+      if (colors[layer] == nullptr || visibilities[layer] == nullptr) {
+        continue;
+      }
+      unsigned char rgba[4];
+      std::copy(::LayerColors[layer], ::LayerColors[layer] + 4, rgba);
+      if (const auto color = this->Attributes.GetDrawnColor(blockId)) {
+        for (int comp = 0; comp < 3; ++comp) {
+          rgba[comp] = static_cast<unsigned char>((*color)[comp] * 255);
+        }
+      }
+      rgba[3] =
+          static_cast<unsigned char>(this->GetBlockOpacity(blockId) * 255);
+      colors[layer]->SetTypedTuple(instanceId, rgba);
+      visibilities[layer]->SetValue(instanceId, this->IsBlockDrawn(blockId));
+      modified[layer] = true;
+    }
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      if (modified[layer]) {
+        colors[layer]->Modified();
+        visibilities[layer]->Modified();
+      }
+    }
+  } else if (this->Strategy == RenderStrategy::Merged) {
+    // hidden blocks have no cells, so their layer is rebuilt. colors are
+    // written in place.
+    const bool visibilityDirty = this->Attributes.IsVisibilityDirty();
+    bool modified[NumLayers] = {};
+    for (const auto &blockId : dirtyBlocks) {
+      const int layer = blockId % NumLayers;
+      const auto &instances = this->MergedInstances[layer];
+      const auto it = std::lower_bound(instances.begin(), instances.end(),
+                                       blockId / NumLayers);
+      if (visibilityDirty) {
+        modified[layer] = true;
+      } else if (it != instances.end() && *it == blockId / NumLayers) {
+        this->ApplyMergedBlockColor(layer, it - instances.begin());
+        modified[layer] = true;
+      }
+    }
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      if (modified[layer] && visibilityDirty) {
+        this->BuildMergedLayer(layer);
+      } else if (modified[layer]) {
+        this->MergedMeshes[layer]->GetCellData()->GetScalars()->Modified();
+      }
+    }
+  } else {
+    for (const auto &blockId : dirtyBlocks) {
+      this->ApplyBlockDisplay(blockId);
+    }
+    this->DisplayAttributes->Modified();
+  }
+  this->Attributes.ClearDirtyBlocks();
+}
+
+void BenchmarkApp::ApplyBlockDisplay(vtkIdType blockId) {
+  const auto pdsIdx = static_cast<unsigned int>(blockId);
+  if (pdsIdx >= this->Meshes->GetNumberOfPartitionedDataSets()) {
+    // not built yet, see BuildCompositeBlocks.
+    return;
+  }
+  const unsigned int numLevels = this->Meshes->GetNumberOfPartitions(pdsIdx);
+  const unsigned int current = this->GetBlockLevel(blockId);
+  for (unsigned int level = 0; level < numLevels; ++level) {
+    auto mesh = this->Meshes->GetPartition(pdsIdx, level);
+    if (mesh == nullptr) {
+      continue;
+    }
+    // only hidden blocks get a visibility entry. the levels not drawn carry
+    // no color or opacity, but the drawn level of every generated block has
+    // a color entry, since one actor draws all the layers.
+    if (level != current) {
+      this->DisplayAttributes->SetBlockVisibility(mesh, false);
+      this->DisplayAttributes->RemoveBlockColor(mesh);
+      this->DisplayAttributes->RemoveBlockOpacity(mesh);
+      continue;
+    }
+    if (this->IsBlockDrawn(blockId)) {
+      this->DisplayAttributes->RemoveBlockVisibility(mesh);
+    } else {
+      this->DisplayAttributes->SetBlockVisibility(mesh, false);
+    }
+    // one color per block instead of an RGBA value per cell. like the opaque
+    // cell scalars it replaces, it sets the ambient and diffuse colors.
+    // loaded meshes keep their own colors.
+    if (const auto color = this->Attributes.GetDrawnColor(blockId)) {
+      this->DisplayAttributes->SetBlockColor(mesh, color->data());
+    } else if (this->SceneCreated) {
+      const auto rgba = ::LayerColors[blockId % NumLayers];
+      const double color[3] = {rgba[0] / 255.0, rgba[1] / 255.0,
+                               rgba[2] / 255.0};
+      this->DisplayAttributes->SetBlockColor(mesh, color);
+    } else {
+      this->DisplayAttributes->RemoveBlockColor(mesh);
+    }
+    const double opacity = this->GetBlockOpacity(blockId);
+    if (opacity < 1) {
+      this->DisplayAttributes->SetBlockOpacity(mesh, opacity);
+    } else {
+      this->DisplayAttributes->RemoveBlockOpacity(mesh);
+    }
+  }
+}
+
+vtkIdType BenchmarkApp::GetBlockIdFromCompositeIndex(unsigned int flatIdx) {
+  // the root comes first, then every partitioned dataset followed by its
+  // partitions. all of them hold the same number of partitions.
+  const unsigned int numBlocks = this->Meshes->GetNumberOfPartitionedDataSets();
+  if (numBlocks == 0 || flatIdx < 2) {
+    return -1;
+  }
+  const unsigned int stride = this->Meshes->GetNumberOfPartitions(0) + 1;
+  return static_cast<vtkIdType>((flatIdx - 2) / stride);
+}
+
+void BenchmarkApp::BuildMergedLayer(int layer) {
+  auto primitive = this->Primitives[layer][0];
+  if (primitive == nullptr) {
+    return;
+  }
+  auto &instances = this->MergedInstances[layer];
+  instances.clear();
+  const vtkIdType numInstances = this->Instances[layer]->GetNumberOfPoints();
+  for (vtkIdType instanceId = 0; instanceId < numInstances; ++instanceId) {
+    if (this->IsBlockVisible(instanceId * NumLayers + layer)) {
+      instances.push_back(instanceId);
+    }
+  }
+  // the sources only make polygons.
+  std::vector<vtkIdType> srcOffsets(1, 0), srcConnectivity;
+  vtkIdType npts = 0;
+  const vtkIdType *pts = nullptr;
+  auto polys = primitive->GetPolys();
+  for (polys->InitTraversal(); polys->GetNextCell(npts, pts);) {
+    srcConnectivity.insert(srcConnectivity.end(), pts, pts + npts);
+    srcOffsets.push_back(static_cast<vtkIdType>(srcConnectivity.size()));
+  }
+  const vtkIdType numCells = static_cast<vtkIdType>(srcOffsets.size()) - 1;
+  const vtkIdType numIds = static_cast<vtkIdType>(srcConnectivity.size());
+  const vtkIdType numPoints = primitive->GetNumberOfPoints();
+  const vtkIdType numDrawn = static_cast<vtkIdType>(instances.size());
+
+  vtkNew<vtkIdTypeArray> offsets;
+  offsets->SetNumberOfValues(numDrawn * numCells + 1);
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfValues(numDrawn * numIds);
+  auto &cellInstanceIds = this->MergedCellInstanceIds[layer];
+  cellInstanceIds->SetName("InstanceIds");
+  cellInstanceIds->SetNumberOfValues(numDrawn * numCells);
+  auto &cellOffsets = this->MergedCellOffsets[layer];
+  cellOffsets.resize(numDrawn + 1);
+  vtkIdType *dstOffsets = offsets->GetPointer(0);
+  vtkIdType *dstConnectivity = connectivity->GetPointer(0);
+  vtkIdType *dstInstanceIds = cellInstanceIds->GetPointer(0);
+  vtkSMPTools::For(0, numDrawn, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType n = begin; n < end; ++n) {
+      const vtkIdType instanceId = instances[n];
+      cellOffsets[n] = n * numCells;
+      for (vtkIdType i = 0; i < numCells; ++i) {
+        dstOffsets[n * numCells + i] = n * numIds + srcOffsets[i];
+        dstInstanceIds[n * numCells + i] = instanceId;
+      }
+      for (vtkIdType i = 0; i < numIds; ++i) {
+        dstConnectivity[n * numIds + i] =
+            srcConnectivity[i] + instanceId * numPoints;
+      }
+    }
+  });
+  dstOffsets[numDrawn * numCells] = numDrawn * numIds;
+  cellOffsets[numDrawn] = numDrawn * numCells;
+  cellInstanceIds->Modified();
+
+  vtkNew<vtkCellArray> cells;
+  cells->SetData(offsets, connectivity);
+  auto &mesh = this->MergedMeshes[layer];
+  mesh->SetPolys(cells);
+  vtkNew<vtkUnsignedCharArray> colors;
+  colors->SetNumberOfComponents(4);
+  colors->SetNumberOfTuples(numDrawn * numCells);
+  mesh->GetCellData()->SetScalars(colors);
+  mesh->GetCellData()->AddArray(cellInstanceIds);
+  for (vtkIdType n = 0; n < numDrawn; ++n) {
+    this->ApplyMergedBlockColor(layer, n);
+  }
+}
+
+void BenchmarkApp::ApplyMergedBlockColor(int layer, vtkIdType n) {
+  auto colors = vtkUnsignedCharArray::SafeDownCast(
+      this->MergedMeshes[layer]->GetCellData()->GetScalars());
+  const vtkIdType blockId = this->MergedInstances[layer][n] * NumLayers + layer;
+  unsigned char rgba[4];
+  std::copy(::LayerColors[layer], ::LayerColors[layer] + 4, rgba);
+  if (const auto color = this->Attributes.GetDrawnColor(blockId)) {
+    for (int comp = 0; comp < 3; ++comp) {
+      rgba[comp] = static_cast<unsigned char>((*color)[comp] * 255);
+    }
+  }
+  rgba[3] = static_cast<unsigned char>(this->GetBlockOpacity(blockId) * 255);
+  const auto &cellOffsets = this->MergedCellOffsets[layer];
+  for (vtkIdType cellId = cellOffsets[n]; cellId < cellOffsets[n + 1];
+       ++cellId) {
+    colors->SetTypedTuple(cellId, rgba);
+  }
+}
+
+void BenchmarkApp::SetLevelOfDetail(bool enabled) {
+  std::cout << __func__ << "(" << enabled << ")" << std::endl;
+  this->LevelOfDetail = enabled;
+}
+
+void BenchmarkApp::SetFrustumCulling(bool enabled) {
+  std::cout << __func__ << "(" << enabled << ")" << std::endl;
+  this->FrustumCulling = enabled;
+}
+
+int BenchmarkApp::GetNumberOfCulledBlocks() {
+  return static_cast<int>(this->NumberOfCulledBlocks);
+}
+
+double BenchmarkApp::GetCullingTime() { return this->CullingTime; }
+
+void BenchmarkApp::UpdateFrustumCulling() {
+  if (this->Strategy == RenderStrategy::Merged) {
+    // a merged layer is a single draw, there is nothing to skip.
+    this->BlockCulled.clear();
+    this->NumberOfCulledBlocks = 0;
+    this->CullingTime = 0;
+    return;
+  }
+  const auto startTime = std::chrono::steady_clock::now();
+  const vtkIdType numBlocks = this->Attributes.GetNumberOfBlocks();
+  if (this->Views.empty() ||
+      numBlocks != static_cast<vtkIdType>(this->BlockBounds.size())) {
+    this->NumberOfCulledBlocks = 0;
+    this->CullingTime = 0;
+    return;
+  }
+  this->NextBlockCulled.assign(numBlocks, this->FrustumCulling);
+  // the views share the actors, a block is drawn when any of them sees it.
+  for (std::size_t view = 0; this->FrustumCulling && view < this->Views.size();
+       ++view) {
+    auto ren = this->Views[view];
+    // the planes point into the frustum, like the ones of the area picker.
+    double planes[24];
+    ren->GetActiveCamera()->GetFrustumPlanes(ren->GetTiledAspectRatio(),
+                                             planes);
+    // only the side planes cull. the clipping range is reset from the bounds
+    // of the drawn blocks, so a block culled by the near or far plane would
+    // not come back into the range. the other two planes keep everything.
+    BlockBVH::Frustum frustum;
+    frustum.fill({0, 0, 0, 1});
+    for (int i = 0; i < 4; ++i) {
+      frustum[i] = {planes[4 * i], planes[4 * i + 1], planes[4 * i + 2],
+                    planes[4 * i + 3]};
+    }
+    for (const auto &blockId : this->BVH.Intersect(frustum)) {
+      this->NextBlockCulled[blockId] = 0;
+    }
+  }
+
+  this->BlockCulled.resize(numBlocks, 0);
+  const bool instanced = this->Strategy == RenderStrategy::Instanced;
+  vtkBitArray *visibilities[NumLayers] = {};
+  for (int layer = 0; instanced && layer < NumLayers; ++layer) {
+    visibilities[layer] = vtkBitArray::SafeDownCast(
+        this->Instances[layer]->GetPointData()->GetArray("Visibility"));
+  }
+  bool modified[NumLayers] = {};
+  vtkIdType numCulled = 0, numChanged = 0;
+  for (vtkIdType blockId = 0; blockId < numBlocks; ++blockId) {
+    const unsigned char culled = this->NextBlockCulled[blockId];
+    numCulled += culled;
+    if (culled == this->BlockCulled[blockId]) {
+      continue;
+    }
+    this->BlockCulled[blockId] = culled;
+    ++numChanged;
+    if (!instanced) {
+      this->ApplyBlockDisplay(blockId);
+    } else if (auto array = visibilities[blockId % NumLayers]) {
+      array->SetValue(blockId / NumLayers, this->IsBlockDrawn(blockId));
+      modified[blockId % NumLayers] = true;
+    }
+  }
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    if (modified[layer]) {
+      visibilities[layer]->Modified();
+    }
+  }
+  if (numChanged > 0) {
+    if (!instanced) {
+      this->DisplayAttributes->Modified();
+    }
+    this->HoverStyle->InvalidateSelectionBuffers();
+  }
+  this->NumberOfCulledBlocks = numCulled;
+  this->CullingTime = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - startTime)
+                          .count();
+}
+
+void BenchmarkApp::UpdateLevelsOfDetail() {
+  const vtkIdType numBlocks = static_cast<vtkIdType>(this->BlockLevels.size());
+  // merged layers are always drawn at the finest level.
+  if (this->Views.empty() || numBlocks == 0 ||
+      this->Strategy == RenderStrategy::Merged ||
+      numBlocks != static_cast<vtkIdType>(this->BlockBounds.size())) {
+    return;
+  }
+  struct Projection {
+    double position[3];
+    bool parallel;
+    // pixels covered by one world unit, at unit distance for perspective
+    // views.
+    double pixelsPerUnit;
+  };
+  std::vector<Projection> projections(this->Views.size());
+  for (std::size_t view = 0; view < this->Views.size(); ++view) {
+    auto ren = this->Views[view];
+    auto cam = ren->GetActiveCamera();
+    auto &projection = projections[view];
+    cam->GetPosition(projection.position);
+    projection.parallel = cam->GetParallelProjection() != 0;
+    const int height = std::max(ren->GetSize()[1], 1);
+    projection.pixelsPerUnit =
+        projection.parallel
+            ? height / (2 * cam->GetParallelScale())
+            : height / (2 * std::tan(vtkMath::RadiansFromDegrees(
+                                cam->GetViewAngle() / 2)));
+  }
+  // reduced frames need blocks twice as large for the same level, coarse
+  // frames draw every block at the coarsest one.
+  const double budget =
+      this->FrameQuality == RenderQuality::Reduced ? 2.0 : 1.0;
+  const bool coarse = this->FrameQuality == RenderQuality::Coarse;
+  this->NextBlockLevels.resize(numBlocks);
+  vtkSMPTools::For(0, numBlocks, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType blockId = begin; blockId < end; ++blockId) {
+      if (!this->LevelOfDetail) {
+        this->NextBlockLevels[blockId] = 0;
+        continue;
+      } else if (coarse) {
+        this->NextBlockLevels[blockId] = NumLevelsOfDetail - 1;
+        continue;
+      }
+      const auto &bounds = this->BlockBounds[blockId];
+      double center[3], diameter = 0;
+      for (int axis = 0; axis < 3; ++axis) {
+        const double length = bounds[2 * axis + 1] - bounds[2 * axis];
+        center[axis] = bounds[2 * axis] + length / 2;
+        diameter += length * length;
+      }
+      diameter = std::sqrt(diameter);
+      // the views share the meshes, the largest projection decides.
+      double pixels = 0;
+      for (const auto &projection : projections) {
+        const double distance =
+            projection.parallel
+                ? 1.0
+                : std::max(std::sqrt(vtkMath::Distance2BetweenPoints(
+                               center, projection.position)),
+                           1e-6);
+        pixels =
+            std::max(pixels, diameter * projection.pixelsPerUnit / distance);
+      }
+      this->NextBlockLevels[blockId] =
+          ::SelectLevelOfDetail(pixels / budget, this->BlockLevels[blockId]);
+    }
+  });
+
+  const bool instanced = this->Strategy == RenderStrategy::Instanced;
+  vtkUnsignedCharArray *levels[NumLayers] = {};
+  for (int layer = 0; instanced && layer < NumLayers; ++layer) {
+    levels[layer] = vtkUnsignedCharArray::SafeDownCast(
+        this->Instances[layer]->GetPointData()->GetArray("LevelOfDetail"));
+  }
+  bool modified[NumLayers] = {};
+  vtkIdType numChanged = 0;
+  for (vtkIdType blockId = 0; blockId < numBlocks; ++blockId) {
+    const unsigned char level = this->NextBlockLevels[blockId];
+    if (level == this->BlockLevels[blockId]) {
+      continue;
+    }
+    this->BlockLevels[blockId] = level;
+    ++numChanged;
+    if (!instanced) {
+      this->ApplyBlockDisplay(blockId);
+    } else if (auto array = levels[blockId % NumLayers]) {
+      array->SetValue(blockId / NumLayers, level);
+      modified[blockId % NumLayers] = true;
+    }
+  }
+  if (numChanged == 0) {
+    return;
+  }
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    if (modified[layer]) {
+      levels[layer]->Modified();
+    }
+  }
+  if (!instanced) {
+    this->DisplayAttributes->Modified();
+  }
+  // the picked meshes change with the level.
+  this->HoverStyle->InvalidateSelectionBuffers();
+}
+
+void BenchmarkApp::SetLineWidth(float width) {
+  std::cout << __func__ << "(" << width << ")" << std::endl;
+  this->LineWidth = width;
+  this->ApplyRenderQuality();
+}
+
+void BenchmarkApp::SetPointSize(float size) {
+  std::cout << __func__ << "(" << size << ")" << std::endl;
+  this->PointSize = size;
+  this->ApplyRenderQuality();
+}
+
+void BenchmarkApp::SetRepresentation(int representation) {
+  std::cout << __func__ << "(" << representation << ")" << std::endl;
+  this->Representation = representation;
+  this->HoverStyle->InvalidateSelectionBuffers();
+  // surface with edges is a surface with edge visibility.
+  this->Actor->GetProperty()->SetRepresentation(
+      std::min(representation, VTK_SURFACE));
+  this->ApplyRenderQuality();
+}
+
+void BenchmarkApp::SetInteractionQuality(bool enabled) {
+  std::cout << __func__ << "(" << enabled << ")" << std::endl;
+  this->InteractionQuality = enabled;
+}
+
+void BenchmarkApp::SetInteractionFrameBudget(double budget) {
+  std::cout << __func__ << "(" << budget << ")" << std::endl;
+  this->InteractionFrameBudget = budget;
+}
+
+BenchmarkApp::RenderQuality BenchmarkApp::GetFrameQuality() {
+  return this->FrameQuality;
+}
+
+std::vector<int> BenchmarkApp::GetFrameQualities() {
+  return this->Timer.GetQualities();
+}
+
+void BenchmarkApp::UpdateRenderQuality() {
+  // interactor styles raise the desired update rate while the camera moves.
+  const bool interacting = this->Window->GetDesiredUpdateRate() >
+                           this->Interactor->GetStillUpdateRate();
+  RenderQuality quality = RenderQuality::Full;
+  if (this->InteractionQuality && interacting && !this->RefineRequested) {
+    quality = std::max(this->FrameQuality, RenderQuality::Reduced);
+    // frame times differ between machines, replays keep the reduced
+    // quality so that they render the same frames everywhere.
+    const double frameTime = this->Timer.GetLastFrame()[FrameTimer::Total];
+    if (this->Replaying) {
+      quality = RenderQuality::Reduced;
+    } else if (frameTime > this->InteractionFrameBudget) {
+      quality = RenderQuality::Coarse;
+    } else if (frameTime < this->InteractionFrameBudget / 2) {
+      quality = RenderQuality::Reduced;
+    }
+  }
+  this->RefineRequested = false;
+  if (quality != this->FrameQuality) {
+    this->FrameQuality = quality;
+    this->ApplyRenderQuality();
+  }
+}
+
+void BenchmarkApp::ApplyRenderQuality() {
+  auto property = this->Actor->GetProperty();
+  const bool full = this->FrameQuality == RenderQuality::Full;
+  property->SetEdgeVisibility(full && this->Representation > VTK_SURFACE);
+  property->SetLineWidth(full ? this->LineWidth : 1.0f);
+  property->SetPointSize(full ? this->PointSize : 1.0f);
+}
+
+void BenchmarkApp::SetSelectedBlockColor(float r, float g, float b) {
+  std::cout << __func__ << "(" << r << ',' << g << ',' << b << ")" << std::endl;
+  this->SelectedBlockColor.Set(r, g, b);
+  this->AreaSelectionActor->GetProperty()->SetColor(r, g, b);
+}
+
+void BenchmarkApp::SetLayerOpacity(LayerID layer, double opacity) {
+  std::cout << __func__ << "(" << layer << ',' << opacity << ")" << std::endl;
+  if (layer < LayerID::Cone || layer >= LayerID::NumLayers) {
+    std::cerr << "Invalid layer " << layer << std::endl;
+    return;
+  }
+  this->LayerOpacities[layer] = std::max(0.0, std::min(opacity, 1.0));
+  // applied with the other block attributes on the next render.
+  auto &blkIds = this->BlockIdsPerLayer[layer];
+  for (vtkIdType i = 0; i < blkIds->GetNumberOfIds(); ++i) {
+    this->Attributes.Invalidate(blkIds->GetId(i));
+  }
+}
+
+void BenchmarkApp::SetSelectedBlockOpacity(double opacity) {
+  std::cout << __func__ << "(" << opacity << ")" << std::endl;
+  this->SelectedBlockOpacity = std::max(0.0, std::min(opacity, 1.0));
+  for (const vtkIdType blockId : this->Attributes.GetColoredBlocks()) {
+    this->Attributes.Invalidate(blockId);
+  }
+}
+
+double BenchmarkApp::GetBlockOpacity(vtkIdType blockId) {
+  if (this->Attributes.HasColor(blockId)) {
+    return this->SelectedBlockOpacity;
+  }
+  // the blocks of loaded files are not in layers.
+  return this->SceneCreated ? this->LayerOpacities[blockId % NumLayers] : 1.0;
+}
+
+void BenchmarkApp::SetTranslucencyTechnique(TranslucencyTechnique technique) {
+  std::cout << __func__ << "(" << technique << ")" << std::endl;
+  this->Translucency = technique;
+  for (const auto &pass : this->TranslucencyPasses) {
+    pass->SetTechnique(technique);
+  }
+}
+
+void BenchmarkApp::SetMaximumNumberOfPeels(int peels) {
+  std::cout << __func__ << "(" << peels << ")" << std::endl;
+  this->MaximumNumberOfPeels = std::max(0, peels);
+  for (const auto &pass : this->TranslucencyPasses) {
+    pass->SetMaximumNumberOfPeels(this->MaximumNumberOfPeels);
+  }
+}
+
+void BenchmarkApp::SetGPUWaitTiming(bool enabled) {
+  std::cout << __func__ << "(" << enabled << ")" << std::endl;
+  this->GPUWaitTiming = enabled;
+  for (const auto &pass : this->TranslucencyPasses) {
+    pass->SetWaitForCompletion(enabled);
+  }
+}
+
+void BenchmarkApp::AddTranslucencyPass(vtkRenderer *ren) {
+  // the default render steps, with the translucent geometry drawn and timed
+  // by a pass of our own instead of the renderer's depth peeling.
+  vtkNew<TranslucencyPass> pass;
+  pass->SetTechnique(this->Translucency);
+  pass->SetMaximumNumberOfPeels(this->MaximumNumberOfPeels);
+  pass->SetWaitForCompletion(this->GPUWaitTiming);
+  vtkNew<vtkRenderStepsPass> steps;
+  steps->SetTranslucentPass(pass);
+  ren->SetPass(steps);
+  this->TranslucencyPasses.emplace_back(pass);
+}
+
+CameraState BenchmarkApp::GetCameraState() {
+  auto ren = this->Window->GetRenderers()->GetFirstRenderer();
+  if (ren == nullptr) {
+    return {};
+  }
+  auto cam = ren->GetActiveCamera();
+  CameraState camState;
+  cam->GetViewUp(camState.viewUp);
+  cam->GetPosition(camState.position);
+  cam->GetFocalPoint(camState.focalPoint);
+  camState.viewAngle = cam->GetViewAngle();
+  return camState;
+}
+
+void BenchmarkApp::SetCameraState(CameraState &state) {
+  auto ren = this->Window->GetRenderers()->GetFirstRenderer();
+  if (ren == nullptr) {
+    return;
+  }
+  auto cam = ren->GetActiveCamera();
+  cam->SetViewUp(state.viewUp);
+  cam->SetPosition(state.position);
+  cam->SetFocalPoint(state.focalPoint);
+  cam->SetViewAngle(state.viewAngle);
+  ren->ResetCameraClippingRange();
+  this->RecordCamera();
+}
+
+double BenchmarkApp::GetDatasetsGenerationTime() {
+  return this->DatasetsGenerationTime;
+}
+
+int BenchmarkApp::LoadScene(const std::string &text) {
+  std::cout << __func__ << "(" << text.size() << ")" << std::endl;
+  SceneDescription scene;
+  std::string error;
+  if (!SceneDescription::Parse(text, scene, error)) {
+    std::cerr << "Invalid scene description, " << error << std::endl;
+    return 0;
+  }
+  return this->CreateScene(scene);
+}
+
+int BenchmarkApp::LoadSceneFile(const std::string &filename) {
+  std::cout << __func__ << "(" << filename << ")" << std::endl;
+  SceneDescription scene;
+  std::string error;
+  if (!SceneDescription::ReadFile(filename, scene, error)) {
+    std::cerr << "Invalid scene description, " << error << std::endl;
+    return 0;
+  }
+  return this->CreateScene(scene);
+}
+
+std::string BenchmarkApp::GetSceneDescription() {
+  return this->SceneCreated ? this->Scene.ToString() : std::string();
+}
+
+void BenchmarkApp::SetShowCameraManipulator(bool show) {
+  this->CamManipulator->SetEnabled(show);
+}
+
+namespace {
+std::string GetExtension(const std::string &filename) {
+  const auto dot = filename.find_last_of('.');
+  std::string ext = dot == std::string::npos ? "" : filename.substr(dot + 1);
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return ext;
+}
+} // namespace
+
+int BenchmarkApp::LoadFileFromBinary(std::uintptr_t buffer, std::size_t size,
+                                     const std::string &filename) {
+  std::cout << __func__ << "(" << filename << ',' << size << ")" << std::endl;
+  const auto startTime = std::chrono::steady_clock::now();
+  // the buffer was allocated with malloc by the caller and is now ours. read
+  // it in place and release it as soon as the meshes are built, so that the
+  // file and the meshes are never held twice.
+  std::unique_ptr<char, decltype(&std::free)> data(
+      reinterpret_cast<char *>(buffer), &std::free);
+  const std::string ext = ::GetExtension(filename);
+  vtkSmartPointer<vtkDataObject> output;
+  if (ext == "vtp") {
+    vtkNew<vtkCharArray> contents;
+    // save=1: the array does not own the buffer.
+    contents->SetArray(data.get(), static_cast<vtkIdType>(size), 1);
+    vtkNew<vtkXMLPolyDataReader> reader;
+    reader->ReadFromInputStringOn();
+    reader->SetInputArray(contents);
+    reader->Update();
+    output = reader->GetOutputDataObject(0);
+  } else if (ext == "stl") {
+    output = ::ReadSTLFromMemory(data.get(), size);
+  } else if (ext == "obj") {
+    output = ::ReadOBJFromMemory(data.get(), size);
+  } else {
+    // vtm files reference other files, those can only be read from disk.
+    std::cerr << "Cannot read " << filename << " from memory" << std::endl;
+    return 0;
+  }
+  // the file and the meshes read from it are both in memory.
+  this->SampleHeapUsage();
+  data.reset();
+  return this->SetLoadedDataObject(output, size, startTime);
+}
+
+int BenchmarkApp::LoadFile(const std::string &filename) {
+  std::cout << __func__ << "(" << filename << ")" << std::endl;
+  const auto startTime = std::chrono::steady_clock::now();
+  const std::string ext = ::GetExtension(filename);
+  vtkSmartPointer<vtkAlgorithm> reader;
+  if (ext == "vtp") {
+    auto xmlReader = vtkSmartPointer<vtkXMLPolyDataReader>::New();
+    xmlReader->SetFileName(filename.c_str());
+    reader = xmlReader;
+  } else if (ext == "vtm") {
+    auto xmlReader = vtkSmartPointer<vtkXMLMultiBlockDataReader>::New();
+    xmlReader->SetFileName(filename.c_str());
+    reader = xmlReader;
+  } else if (ext == "stl") {
+    auto stlReader = vtkSmartPointer<vtkSTLReader>::New();
+    stlReader->SetFileName(filename.c_str());
+    reader = stlReader;
+  } else if (ext == "obj") {
+    auto objReader = vtkSmartPointer<vtkOBJReader>::New();
+    objReader->SetFileName(filename.c_str());
+    reader = objReader;
+  } else {
+    std::cerr << "Unsupported file " << filename << std::endl;
+    return 0;
+  }
+  reader->Update();
+  std::size_t size = 0;
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  if (file) {
+    size = static_cast<std::size_t>(file.tellg());
+  }
+  return this->SetLoadedDataObject(reader->GetOutputDataObject(0), size,
+                                   startTime);
+}
+
+int BenchmarkApp::SetLoadedDataObject(
+    vtkDataObject *dobj, std::size_t bytes,
+    std::chrono::steady_clock::time_point startTime) {
+  if (dobj == nullptr) {
+    std::cerr << "Failed to read the file" << std::endl;
+    return 0;
+  }
+  // loaded meshes are unrelated to the synthetic grid and its layers.
+  this->ClearScene();
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    this->BlockIdsPerLayer[layer]->Reset();
+    for (int level = 0; level < NumLevelsOfDetail; ++level) {
+      this->Primitives[layer][level] = nullptr;
+    }
+  }
+  this->SceneCreated = false;
+  this->NumberOfInstances = this->NumberOfBuiltInstances = 0;
+  this->NumberOfStagedInstances = 0;
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    this->Centers[layer] = nullptr;
+  }
+  if (this->Strategy != RenderStrategy::Composite) {
+    std::cout << "Loaded meshes use the Composite strategy" << std::endl;
+  }
+  this->Strategy = RenderStrategy::Composite;
+  // loaded meshes have a single level of detail.
+  this->BlockLevels.clear();
+  this->BlockCulled.clear();
+
+  std::vector<vtkDataObject *> leaves;
+  if (auto cds = vtkCompositeDataSet::SafeDownCast(dobj)) {
+    for (vtkDataObject *leaf : vtk::Range(cds)) {
+      leaves.emplace_back(leaf);
+    }
+  } else {
+    leaves.emplace_back(dobj);
+  }
+  unsigned int partitionIdx = 0;
+  for (auto leaf : leaves) {
+    vtkSmartPointer<vtkPolyData> mesh = vtkPolyData::SafeDownCast(leaf);
+    if (mesh == nullptr && vtkDataSet::SafeDownCast(leaf) != nullptr) {
+      vtkNew<vtkDataSetSurfaceFilter> surface;
+      surface->SetInputDataObject(leaf);
+      surface->Update();
+      mesh = surface->GetOutput();
+    }
+    if (mesh != nullptr) {
+      this->Meshes->SetPartition(partitionIdx++, 0, mesh);
+    }
+  }
+  this->Attributes.Reset(partitionIdx);
+  this->UpdateBlockBounds();
+  this->UpdateMappers();
+  this->UpdateDatasetsMemoryStats();
+  this->MarkStartup(StartupPhase::SceneReady);
+
+  this->LoadTime = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - startTime)
+                       .count();
+  this->LoadedBytes = static_cast<double>(bytes);
+  std::cout << "Loaded " << partitionIdx << " objects from " << bytes
+            << " bytes in " << this->LoadTime << "ms" << std::endl;
+  return static_cast<int>(partitionIdx);
+}
+
+std::size_t BenchmarkApp::WriteSceneCache() {
+  std::cout << __func__ << std::endl;
+  this->SceneCacheData.clear();
+  // the other strategies are generated faster than a snapshot is read.
+  if (this->Strategy != RenderStrategy::Composite ||
+      this->IsConstructionPending() ||
+      this->Meshes->GetNumberOfPartitionedDataSets() == 0) {
+    return 0;
+  }
+  SceneCache cache;
+  if (this->SceneCreated) {
+    cache.Description = this->Scene.ToString();
+    cache.Generator = ::GeneratorFingerprint(this->Scene);
+  }
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    auto ids = this->BlockIdsPerLayer[layer];
+    cache.Layers.emplace_back(ids->begin(), ids->end());
+  }
+  const vtkIdType numBlocks = this->Attributes.GetNumberOfBlocks();
+  cache.Visibility.resize(numBlocks);
+  for (vtkIdType blockId = 0; blockId < numBlocks; ++blockId) {
+    cache.Visibility[blockId] = this->Attributes.GetVisibility(blockId);
+    if (this->Attributes.HasColor(blockId)) {
+      cache.Colors.emplace_back(blockId, this->Attributes.GetColor(blockId));
+    }
+  }
+  cache.Bounds = this->BlockBounds;
+  cache.Write(this->Meshes, this->SceneCacheData);
+  return this->SceneCacheData.size();
+}
+
+std::uintptr_t BenchmarkApp::GetSceneCacheData() {
+  return reinterpret_cast<std::uintptr_t>(this->SceneCacheData.data());
+}
+
+void BenchmarkApp::ReleaseSceneCache() {
+  std::vector<char>().swap(this->SceneCacheData);
+}
+
+bool BenchmarkApp::SaveSceneCache(const std::string &filename) {
+  std::cout << __func__ << "(" << filename << ")" << std::endl;
+  const std::size_t size = this->WriteSceneCache();
+  std::ofstream file(filename, std::ios::binary);
+  const bool saved = size > 0 && file &&
+                     file.write(this->SceneCacheData.data(),
+                                static_cast<std::streamsize>(size));
+  this->ReleaseSceneCache();
+  if (!saved) {
+    std::cerr << "Cannot save the scene cache to " << filename << std::endl;
+  }
+  return saved;
+}
+
+int BenchmarkApp::LoadSceneCache(const std::string &filename) {
+  std::cout << __func__ << "(" << filename << ")" << std::endl;
+  const auto startTime = std::chrono::steady_clock::now();
+  auto buffer = SceneCache::Buffer::MapFile(filename);
+  if (buffer == nullptr) {
+    std::cerr << "Cannot open " << filename << std::endl;
+    return 0;
+  }
+  return this->SetSceneCache(std::move(buffer), startTime);
+}
+
+int BenchmarkApp::LoadSceneCacheFromBinary(std::uintptr_t buffer,
+                                           std::size_t size) {
+  std::cout << __func__ << "(" << size << ")" << std::endl;
+  const auto startTime = std::chrono::steady_clock::now();
+  return this->SetSceneCache(
+      SceneCache::Buffer::Adopt(reinterpret_cast<void *>(buffer), size),
+      startTime);
+}
+
+int BenchmarkApp::SetSceneCache(
+    std::unique_ptr<SceneCache::Buffer> buffer,
+    std::chrono::steady_clock::time_point startTime) {
+  SceneCache cache;
+  vtkNew<vtkPartitionedDataSetCollection> meshes;
+  std::string error;
+  if (!cache.Read(buffer->GetData(), buffer->GetSize(), meshes, error)) {
+    std::cerr << "Invalid scene cache, " << error << std::endl;
+    return 0;
+  }
+  // the previous scene is still there.
+  this->SampleHeapUsage();
+  SceneDescription scene;
+  const bool created = !cache.Description.empty() &&
+                       SceneDescription::Parse(cache.Description, scene, error);
+  if (created && this->Strategy != RenderStrategy::Composite) {
+    // the snapshot holds composite blocks, the other strategies only need
+    // the description.
+    return this->CreateScene(scene);
+  }
+  if (created && cache.Generator != ::GeneratorFingerprint(scene)) {
+    std::cerr << "Invalid scene cache, generated by another build"
+              << std::endl;
+    return 0;
+  }
+  const vtkIdType numBlocks = meshes->GetNumberOfPartitionedDataSets();
+  if (cache.Layers.size() != NumLayers ||
+      static_cast<vtkIdType>(cache.Bounds.size()) != numBlocks) {
+    std::cerr << "Invalid scene cache, " << cache.Layers.size()
+              << " layers and " << cache.Bounds.size() << " bounds"
+              << std::endl;
+    return 0;
+  }
+
+  this->ClearScene();
+  this->Meshes->ShallowCopy(meshes);
+  this->SceneCacheBuffer = std::move(buffer);
+  this->SceneCreated = created;
+  if (created) {
+    this->Scene = scene;
+  }
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    const auto &ids = cache.Layers[layer];
+    this->BlockIdsPerLayer[layer]->SetNumberOfIds(
+        static_cast<vtkIdType>(ids.size()));
+    std::copy(ids.begin(), ids.end(), this->BlockIdsPerLayer[layer]->begin());
+    for (int level = 0; level < NumLevelsOfDetail; ++level) {
+      this->Primitives[layer][level] = nullptr;
+    }
+    this->Centers[layer] = nullptr;
+  }
+  this->NumberOfInstances = this->NumberOfBuiltInstances = 0;
+  this->NumberOfStagedInstances = 0;
+  this->Strategy = RenderStrategy::Composite;
+  // generated blocks have every level of detail, loaded ones a single one.
+  if (created) {
+    this->BlockLevels.assign(numBlocks, 0);
+  } else {
+    this->BlockLevels.clear();
+  }
+  this->BlockCulled.clear();
+  this->Attributes.Reset(numBlocks);
+  for (vtkIdType blockId = 0; blockId < numBlocks; ++blockId) {
+    if (!cache.Visibility[blockId]) {
+      this->Attributes.SetVisibility(blockId, blockId + 1, false);
+    }
+  }
+  // the scene colors come with the description, the snapshot only lists the
+  // overrides.
+  for (const auto &range : this->Scene.blocks) {
+    if (created && !range.hide) {
+      this->Attributes.SetSceneColor(range.begin, range.end, range.color);
+    }
+  }
+  for (const auto &color : cache.Colors) {
+    if (color.first >= 0 && color.first < numBlocks) {
+      this->Attributes.SetColor(color.first, color.first + 1, color.second);
+    }
+  }
+  for (vtkIdType blockId = 0; blockId < numBlocks; ++blockId) {
+    this->ApplyBlockDisplay(blockId);
+  }
+  this->DisplayAttributes->Modified();
+  // the bounds come with the snapshot, only the hierarchy is built.
+  this->BlockBounds = std::move(cache.Bounds);
+  this->BVH.Build(this->BlockBounds);
+  this->UpdateMappers();
+  this->UpdateDatasetsMemoryStats();
+  this->MarkStartup(StartupPhase::SceneReady);
+
+  const std::size_t bytes = this->SceneCacheBuffer->GetSize();
+  this->LoadTime = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - startTime)
+                       .count();
+  this->LoadedBytes = static_cast<double>(bytes);
+  std::cout << "Loaded " << numBlocks << " objects from a " << bytes
+            << " bytes scene cache in " << this->LoadTime << "ms" << std::endl;
+  return static_cast<int>(numBlocks);
+}
+
+double BenchmarkApp::GetLoadTime() { return this->LoadTime; }
+
+double BenchmarkApp::GetLoadedBytes() { return this->LoadedBytes; }
+
+void BenchmarkApp::SetOffScreenRendering(bool offscreen) {
+  std::cout << __func__ << "(" << offscreen << ")" << std::endl;
+  this->Window->SetOffScreenRendering(offscreen);
+  this->Window->SetShowWindow(!offscreen);
+}
+
+void BenchmarkApp::SetWindowSize(int width, int height) {
+  std::cout << __func__ << "(" << width << ',' << height << ")" << std::endl;
+  this->Window->SetSize(width, height);
+  this->RecordWindowSize();
+}
+
+void BenchmarkApp::OrbitCamera(double azimuth) {
+  for (const auto &view : this->Views) {
+    view->GetActiveCamera()->Azimuth(azimuth);
+    view->ResetCameraClippingRange();
+  }
+}
+
+namespace {
+// Adds the primitives submitted for `copies` draws of the mesh.
+void CountPrimitives(vtkPolyData *mesh, vtkIdType copies, int representation,
+                     PrimitiveCounts &counts) {
+  const bool surface = representation >= VTK_SURFACE;
+  const bool edges =
+      representation > VTK_SURFACE || representation == VTK_WIREFRAME;
+  if (representation == VTK_POINTS) {
+    counts.points += copies * mesh->GetNumberOfPoints();
+    return;
+  }
+  PrimitiveCounts mine;
+  vtkIdType npts = 0;
+  const vtkIdType *pts = nullptr;
+  auto polys = mesh->GetPolys();
+  for (polys->InitTraversal(); polys->GetNextCell(npts, pts);) {
+    mine.triangles += surface ? npts - 2 : 0;
+    mine.lines += edges ? npts : 0;
+  }
+  auto strips = mesh->GetStrips();
+  for (strips->InitTraversal(); strips->GetNextCell(npts, pts);) {
+    mine.triangles += surface ? npts - 2 : 0;
+  }
+  auto lines = mesh->GetLines();
+  for (lines->InitTraversal(); lines->GetNextCell(npts, pts);) {
+    mine.lines += npts - 1;
+  }
+  mine.points += mesh->GetNumberOfVerts();
+  counts.triangles += copies * mine.triangles;
+  counts.lines += copies * mine.lines;
+  counts.points += copies * mine.points;
+}
+
+// float positions, and normals when the mesh has them.
+double VertexBufferSize(vtkPolyData *mesh) {
+  const bool normals = mesh->GetPointData()->GetNormals() != nullptr;
+  return static_cast<double>(mesh->GetNumberOfPoints()) * (normals ? 24 : 12);
+}
+} // namespace
+
+void BenchmarkApp::UpdateMeshSizes() {
+  // every block of a generated layer is a translated copy of the same
+  // primitive, the first one stands for all of them.
+  const unsigned int numBlocks = this->Meshes->GetNumberOfPartitionedDataSets();
+  const std::size_t numSizes =
+      this->SceneCreated ? NumLayers * NumLevelsOfDetail : numBlocks;
+  if (this->MeshSizesRepresentation == this->Representation &&
+      this->MeshSizes.size() == numSizes) {
+    return;
+  }
+  if (this->SceneCreated && numBlocks < NumLayers) {
+    return;
+  }
+  this->MeshSizes.assign(numSizes, MeshSize());
+  for (std::size_t i = 0; i < numSizes; ++i) {
+    const auto blockId = static_cast<unsigned int>(
+        this->SceneCreated ? i / NumLevelsOfDetail : i);
+    const auto level = static_cast<unsigned int>(
+        this->SceneCreated ? i % NumLevelsOfDetail : 0);
+    auto mesh =
+        vtkPolyData::SafeDownCast(this->Meshes->GetPartition(blockId, level));
+    if (mesh == nullptr) {
+      continue;
+    }
+    auto &size = this->MeshSizes[i];
+    ::CountPrimitives(mesh, 1, this->Representation, size.counts);
+    size.vertexBytes = ::VertexBufferSize(mesh);
+    // block colors are uniforms, only loaded meshes may bring cell colors
+    // that go into a texture.
+    size.colorBytes = mesh->GetCellData()->GetScalars() != nullptr
+                          ? 4.0 * mesh->GetNumberOfCells()
+                          : 0.0;
+  }
+  this->MeshSizesRepresentation = this->Representation;
+}
+
+const BenchmarkApp::MeshSize &BenchmarkApp::GetMeshSize(vtkIdType blockId,
+                                                        int level) {
+  static const MeshSize none;
+  const auto i = static_cast<std::size_t>(
+      this->SceneCreated ? (blockId % NumLayers) * NumLevelsOfDetail + level
+                         : blockId);
+  return i < this->MeshSizes.size() ? this->MeshSizes[i] : none;
+}
+
+PrimitiveCounts BenchmarkApp::GetPrimitiveCounts() {
+  PrimitiveCounts counts;
+  // merged layers hold the same cells as the instances they replace.
+  if (this->Strategy != RenderStrategy::Composite) {
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      for (int level = 0; level < NumLevelsOfDetail; ++level) {
+        if (this->Primitives[layer][level] == nullptr) {
+          continue;
+        }
+        ::CountPrimitives(this->Primitives[layer][level],
+                          this->CountDrawnBlocks(LayerID(layer), level),
+                          this->Representation, counts);
+      }
+    }
+    return counts;
+  }
+  // the cells are counted once per mesh, not on every call.
+  this->UpdateMeshSizes();
+  const unsigned int numBlocks = this->Meshes->GetNumberOfPartitionedDataSets();
+  for (unsigned int i = 0; i < numBlocks; ++i) {
+    if (!this->IsBlockDrawn(i)) {
+      continue;
+    }
+    const auto &size = this->GetMeshSize(i, this->GetBlockLevel(i));
+    counts.triangles += size.counts.triangles;
+    counts.lines += size.counts.lines;
+    counts.points += size.counts.points;
+  }
+  return counts;
+}
+
+vtkIdType BenchmarkApp::CountDrawnBlocks(LayerID layer, int level) {
+  vtkIdType numVisible = 0;
+  auto &blkIds = this->BlockIdsPerLayer[layer];
+  for (auto it = blkIds->begin(); it != blkIds->end(); ++it) {
+    numVisible +=
+        this->IsBlockDrawn(*it) && this->GetBlockLevel(*it) == level;
+  }
+  return numVisible;
+}
+
+int BenchmarkApp::GetBlockLevel(vtkIdType blockId) {
+  return static_cast<std::size_t>(blockId) < this->BlockLevels.size()
+             ? this->BlockLevels[blockId]
+             : 0;
+}
+
+namespace {
+double GetArraySize(vtkAbstractArray *array) {
+  if (array->GetDataType() == VTK_BIT) {
+    return static_cast<double>((array->GetNumberOfValues() + 7) / 8);
+  }
+  return static_cast<double>(array->GetNumberOfValues()) *
+         array->GetDataTypeSize();
+}
+
+// Sums the memory of every array once, even when it is shared by many blocks.
+void AccumulateMemorySize(vtkPolyData *mesh,
+                          std::unordered_set<vtkObject *> &seen,
+                          MemoryStats &stats) {
+  if (mesh == nullptr) {
+    return;
+  }
+  auto add = [&](vtkAbstractArray *array, double &bytes) {
+    if (array != nullptr && seen.insert(array).second) {
+      bytes += ::GetArraySize(array);
+    }
+  };
+  if (auto points = mesh->GetPoints()) {
+    add(points->GetData(), stats.points);
+  }
+  for (auto cells : {mesh->GetVerts(), mesh->GetLines(), mesh->GetPolys(),
+                     mesh->GetStrips()}) {
+    add(cells->GetOffsetsArray(), stats.cells);
+    add(cells->GetConnectivityArray(), stats.cells);
+  }
+  for (auto dsa : {static_cast<vtkDataSetAttributes *>(mesh->GetPointData()),
+                   static_cast<vtkDataSetAttributes *>(mesh->GetCellData())}) {
+    for (int i = 0; i < dsa->GetNumberOfArrays(); ++i) {
+      auto array = dsa->GetAbstractArray(i);
+      add(array, array == dsa->GetScalars() ? stats.colors : stats.otherArrays);
+    }
+  }
+}
+
+void GetHeapUsage(double &size, double &used) {
+#if defined(__EMSCRIPTEN__)
+  size = static_cast<double>(emscripten_get_heap_size());
+  used = static_cast<double>(mallinfo().uordblks);
+#elif defined(__GLIBC__) &&                                                    \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  const auto info = mallinfo2();
+  size = static_cast<double>(info.arena + info.hblkhd);
+  used = static_cast<double>(info.uordblks + info.hblkhd);
+#else
+  size = used = 0;
+#endif
+}
+} // namespace
+
+void BenchmarkApp::UpdateDatasetsMemoryStats() {
+  std::unordered_set<vtkObject *> seen;
+  MemoryStats stats;
+  const unsigned int numBlocks = this->Meshes->GetNumberOfPartitionedDataSets();
+  for (unsigned int i = 0; i < numBlocks; ++i) {
+    for (unsigned int level = 0; level < this->Meshes->GetNumberOfPartitions(i);
+         ++level) {
+      ::AccumulateMemorySize(
+          vtkPolyData::SafeDownCast(this->Meshes->GetPartition(i, level)),
+          seen, stats);
+    }
+  }
+  if (this->Strategy != RenderStrategy::Composite) {
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      for (int level = 0; level < NumLevelsOfDetail; ++level) {
+        ::AccumulateMemorySize(this->Primitives[layer][level], seen, stats);
+      }
+      ::AccumulateMemorySize(this->Instances[layer], seen, stats);
+      ::AccumulateMemorySize(this->MergedMeshes[layer], seen, stats);
+    }
+  }
+  this->Memory.points = stats.points;
+  this->Memory.cells = stats.cells;
+  this->Memory.colors = stats.colors;
+  this->Memory.otherArrays = stats.otherArrays;
+  this->SampleHeapUsage();
+}
+
+void BenchmarkApp::SampleHeapUsage() {
+  ::GetHeapUsage(this->Memory.heapSize, this->Memory.heapUsed);
+  this->Memory.heapHighWaterMark =
+      std::max(this->Memory.heapHighWaterMark, this->Memory.heapUsed);
+}
+
+unsigned long BenchmarkApp::GetDatasetsMemorySize() {
+  const double bytes = this->Memory.points + this->Memory.cells +
+                       this->Memory.colors + this->Memory.otherArrays;
+  return static_cast<unsigned long>(std::ceil(bytes / 1024));
+}
+
+double BenchmarkApp::EstimateGPUBufferSize() {
+  // 32 bit indices: 3 per triangle, 2 per line segment and 1 per point.
+  auto indexBufferSize = [](const PrimitiveCounts &counts) {
+    return 4.0 * (3 * counts.triangles + 2 * counts.lines + counts.points);
+  };
+  double bytes = 0;
+  if (this->Strategy == RenderStrategy::Instanced) {
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      for (int level = 0; level < NumLevelsOfDetail; ++level) {
+        auto primitive = this->Primitives[layer][level];
+        const vtkIdType numVisible =
+            this->CountDrawnBlocks(LayerID(layer), level);
+        if (primitive == nullptr || numVisible == 0) {
+          continue;
+        }
+        // the mesh is uploaded once, plus a 4x4 matrix, a 3x3 normal matrix
+        // and a RGBA color per instance.
+        PrimitiveCounts counts;
+        ::CountPrimitives(primitive, 1, this->Representation, counts);
+        bytes += ::VertexBufferSize(primitive) + indexBufferSize(counts) +
+                 numVisible * (25.0 * sizeof(float) + 4);
+      }
+    }
+    return bytes;
+  }
+  if (this->Strategy == RenderStrategy::Merged) {
+    // every copy of the points is uploaded, hidden blocks only drop their
+    // indices.
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      auto mesh = this->MergedMeshes[layer].GetPointer();
+      bytes += ::VertexBufferSize(mesh) + 4.0 * mesh->GetNumberOfCells();
+    }
+    return bytes + indexBufferSize(this->GetPrimitiveCounts());
+  }
+  // every partition is an input of the mapper, which builds its buffers
+  // whether it is drawn or not. hidden blocks and the levels not drawn
+  // count too.
+  this->UpdateMeshSizes();
+  const unsigned int numBlocks = this->Meshes->GetNumberOfPartitionedDataSets();
+  for (unsigned int i = 0; i < numBlocks; ++i) {
+    const unsigned int numLevels = this->Meshes->GetNumberOfPartitions(i);
+    for (unsigned int level = 0; level < numLevels; ++level) {
+      const auto &size = this->GetMeshSize(i, static_cast<int>(level));
+      bytes += size.vertexBytes + size.colorBytes +
+               indexBufferSize(size.counts);
+    }
+  }
+  return bytes;
+}
+
+MemoryStats BenchmarkApp::GetMemoryStats() {
+  MemoryStats stats = this->Memory;
+  stats.gpuBuffers = this->EstimateGPUBufferSize();
+  return stats;
+}
+
+void BenchmarkApp::PrintMemoryStats() {
+  const MemoryStats stats = this->GetMemoryStats();
+  const auto kib = [](double bytes) { return bytes / 1024; };
+  std::cout << "Memory (KiB)\n"
+            << "\theap size: " << kib(stats.heapSize) << '\n'
+            << "\theap used: " << kib(stats.heapUsed) << '\n'
+            << "\theap high-water mark: " << kib(stats.heapHighWaterMark)
+            << '\n'
+            << "\tpoints: " << kib(stats.points) << '\n'
+            << "\tcells: " << kib(stats.cells) << '\n'
+            << "\tcolors: " << kib(stats.colors) << '\n'
+            << "\tother arrays: " << kib(stats.otherArrays) << '\n'
+            << "\tGPU buffers (estimate): " << kib(stats.gpuBuffers)
+            << std::endl;
+}
+
+double BenchmarkApp::GetStartupTime(StartupPhase phase) {
+  return this->StartupTimes[phase];
+}
+
+const char *BenchmarkApp::GetStartupPhaseName(StartupPhase phase) {
+  switch (phase) {
+  case Constructed:
+    return "constructed";
+  case Initialized:
+    return "initialized";
+  case SceneReady:
+    return "scene ready";
+  case FirstFrame:
+    return "first frame";
+  default:
+    return "unknown";
+  }
+}
+
+void BenchmarkApp::MarkStartup(StartupPhase phase) {
+  if (this->StartupTimes[phase] >= 0) {
+    return;
+  }
+  this->StartupTimes[phase] = ::GetStartupClock();
+  if (phase == StartupPhase::FirstFrame) {
+    this->PrintStartupTimes();
+  }
+}
+
+void BenchmarkApp::PrintStartupTimes() {
+  std::cout << "Startup (ms)\n";
+  for (int phase = 0; phase < NumberOfStartupPhases; ++phase) {
+    std::cout << '\t' << GetStartupPhaseName(StartupPhase(phase)) << ": "
+              << this->StartupTimes[phase] << '\n';
+  }
+  std::cout << std::flush;
+}
+
+void BenchmarkApp::HoverPick(int x, int y) {
+  if (this->Interactor->GetInteractorStyle() != this->HoverStyle) {
+    return;
+  }
+  this->Interactor->SetEventPosition(x, y);
+  this->HoverStyle->OnMouseMove();
+  this->HoverStyle->FlushPendingPick();
+}
+
+double BenchmarkApp::GetHoverPickTime() {
+  return this->HoverStyle->PopPickTime();
+}
+
+// Called after area picker finished.
+void BenchmarkApp::EndPickHandler(vtkObject *caller, unsigned long, void *) {
+  // the rubber band was drawn in the view the picker ran in.
+  auto picker = vtkAbstractPicker::SafeDownCast(caller);
+  vtkRenderer *ren = picker != nullptr && picker->GetRenderer() != nullptr
+                         ? picker->GetRenderer()
+                         : this->Views[0].Get();
+  this->AreaPick(static_cast<int>(ren->GetPickX1()),
+                 static_cast<int>(ren->GetPickY1()),
+                 static_cast<int>(ren->GetPickX2()),
+                 static_cast<int>(ren->GetPickY2()));
+}
+
+void BenchmarkApp::AreaPick(int x0, int y0, int x1, int y1) {
+  if (this->AreaPickerType == AreaPicker::BoundingVolumeHierarchy) {
+    this->AreaPickWithBVH(x0, y0, x1, y1);
+  } else {
+    this->AreaPickWithHardwareSelector(x0, y0, x1, y1);
+  }
+  this->Window->Render();
+}
+
+void BenchmarkApp::AreaPickWithHardwareSelector(int x0, int y0, int x1,
+                                                int y1) {
+  const auto startTime = std::chrono::steady_clock::now();
+  auto ren = this->GetViewAt(x0, y0);
+  const bool instanced = this->Strategy == RenderStrategy::Instanced;
+  const bool merged = this->Strategy == RenderStrategy::Merged;
+
+  vtkNew<vtkHardwareSelector> sel;
+  // the glyph mapper reports the picked instances as point ids.
+  sel->SetFieldAssociation(instanced
+                               ? vtkDataObject::FIELD_ASSOCIATION_POINTS
+                               : vtkDataObject::FIELD_ASSOCIATION_CELLS);
+  sel->SetRenderer(ren);
+  sel->SetArea(x0, y0, x1, y1);
+  vtkSmartPointer<vtkSelection> res;
+  res.TakeReference(sel->Select());
+  if (!res) {
+    cerr << "Selection not supported." << endl;
+    return;
+  }
+
+  auto &selection = this->SelectedCells;
+  selection.Clear();
   for (unsigned int i = 0; i < res->GetNumberOfNodes(); ++i) {
-    auto flatIdx = res->GetNode(i)->GetProperties()->Get(
-        vtkSelectionNode::COMPOSITE_INDEX());
-    auto dset = this->Meshes->GetDataSet(flatIdx);
-    this->DisplayAttributes->SetBlockColor(dset,
-                                           this->SelectedBlockColor.GetData());
+    auto node = res->GetNode(i);
+    auto ids = vtkIdTypeArray::SafeDownCast(node->GetSelectionList());
+    if (ids == nullptr) {
+      continue;
+    }
+    const vtkIdType *values = ids->GetPointer(0);
+    const vtkIdType numValues = ids->GetNumberOfValues();
+    if (!instanced && !merged) {
+      // cell ids of the partition the block is drawn with.
+      const vtkIdType blockId = this->GetBlockIdFromCompositeIndex(
+          node->GetProperties()->Get(vtkSelectionNode::COMPOSITE_INDEX()));
+      if (blockId >= 0) {
+        selection.StartBlock(blockId, this->GetBlockLevel(blockId));
+        for (vtkIdType j = 0; j < numValues; ++j) {
+          selection.AddCell(values[j]);
+        }
+      }
+      continue;
+    }
+    auto prop = node->GetProperties()->Get(vtkSelectionNode::PROP());
+    for (int layer = 0; layer < NumLayers; ++layer) {
+      if (merged && prop == this->MergedActors[layer].GetPointer()) {
+        this->SelectMergedCells(layer, values, numValues);
+      }
+      // the instances are picked whole, with every cell of their level.
+      if (instanced && prop == this->InstancedActors[layer].GetPointer()) {
+        for (vtkIdType j = 0; j < numValues; ++j) {
+          const vtkIdType blockId = values[j] * NumLayers + layer;
+          double translation[3];
+          const int level = this->GetBlockLevel(blockId);
+          if (auto mesh = this->GetBlockMesh(blockId, level, translation)) {
+            selection.StartBlock(blockId, level);
+            selection.AddCellRange(mesh->GetNumberOfCells());
+          }
+        }
+      }
+    }
+  }
+  selection.Finalize();
+  this->UpdateAreaSelectionMesh();
+  this->AreaPickTime = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - startTime)
+                           .count();
+  this->PendingAreaPickTime += this->AreaPickTime;
+  std::cout << __func__ << " selected " << selection.GetNumberOfCells()
+            << " cells of " << selection.GetNumberOfBlocks() << " blocks in "
+            << this->AreaPickTime << "ms" << std::endl;
+}
+
+void BenchmarkApp::SelectMergedCells(int layer, const vtkIdType *cellIds,
+                                     vtkIdType numCells) {
+  const auto &cellOffsets = this->MergedCellOffsets[layer];
+  if (cellOffsets.empty()) {
+    return;
+  }
+  // the cells of a block mostly come in a row, the block is only looked up
+  // when a cell falls outside of the current one.
+  vtkIdType n = -1;
+  for (vtkIdType j = 0; j < numCells; ++j) {
+    const vtkIdType cellId = cellIds[j];
+    if (cellId < 0 || cellId >= cellOffsets.back()) {
+      continue;
+    }
+    if (n < 0 || cellId < cellOffsets[n] || cellId >= cellOffsets[n + 1]) {
+      const auto it =
+          std::upper_bound(cellOffsets.begin(), cellOffsets.end(), cellId);
+      n = std::distance(cellOffsets.begin(), it) - 1;
+      const vtkIdType blockId =
+          this->MergedInstances[layer][n] * NumLayers + layer;
+      this->SelectedCells.StartBlock(blockId, 0);
+    }
+    this->SelectedCells.AddCell(cellId - cellOffsets[n]);
+  }
+}
+
+void BenchmarkApp::AreaPickWithBVH(int x0, int y0, int x1, int y1) {
+  const auto startTime = std::chrono::steady_clock::now();
+  auto ren = this->GetViewAt(x0, y0);
+  // a rubber band of zero width still selects what is under the pixel.
+  const double xmin = std::min(x0, x1), xmax = std::max(x0, x1) + 1.0;
+  const double ymin = std::min(y0, y1), ymax = std::max(y0, y1) + 1.0;
+  const double display[4][2] = {
+      {xmin, ymin}, {xmax, ymin}, {xmax, ymax}, {xmin, ymax}};
+  // corners of the frustum on the near (z=0) and far (z=1) planes.
+  double corners[4][2][3];
+  double centroid[3] = {0.0, 0.0, 0.0};
+  for (int i = 0; i < 4; ++i) {
+    for (int z = 0; z < 2; ++z) {
+      ren->SetDisplayPoint(display[i][0], display[i][1], z);
+      ren->DisplayToWorld();
+      const double *world = ren->GetWorldPoint();
+      for (int comp = 0; comp < 3; ++comp) {
+        corners[i][z][comp] = world[comp] / world[3];
+        centroid[comp] += corners[i][z][comp] / 8.0;
+      }
+    }
+  }
+  // near, far and the four sides.
+  const double *planePoints[6][3] = {
+      {corners[0][0], corners[1][0], corners[2][0]},
+      {corners[0][1], corners[1][1], corners[2][1]},
+      {corners[0][0], corners[1][0], corners[0][1]},
+      {corners[1][0], corners[2][0], corners[1][1]},
+      {corners[2][0], corners[3][0], corners[2][1]},
+      {corners[3][0], corners[0][0], corners[3][1]}};
+  BlockBVH::Frustum frustum;
+  for (int i = 0; i < 6; ++i) {
+    double u[3], v[3], normal[3];
+    vtkMath::Subtract(planePoints[i][1], planePoints[i][0], u);
+    vtkMath::Subtract(planePoints[i][2], planePoints[i][0], v);
+    vtkMath::Cross(u, v, normal);
+    vtkMath::Normalize(normal);
+    double d = -vtkMath::Dot(normal, planePoints[i][0]);
+    // point the normals into the frustum.
+    if (vtkMath::Dot(normal, centroid) + d < 0) {
+      vtkMath::MultiplyScalar(normal, -1.0);
+      d = -d;
+    }
+    frustum[i] = {normal[0], normal[1], normal[2], d};
+  }
+
+  // unlike the hardware selector, this also selects occluded blocks.
+  std::vector<vtkIdType> blockIds = this->BVH.Intersect(frustum);
+  // hidden blocks cannot be picked.
+  blockIds.erase(std::remove_if(blockIds.begin(), blockIds.end(),
+                                [this](vtkIdType blockId) {
+                                  return !this->IsBlockVisible(blockId);
+                                }),
+                 blockIds.end());
+  this->SelectCellsInFrustum(blockIds, frustum);
+  this->UpdateAreaSelectionMesh();
+  this->AreaPickTime = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - startTime)
+                           .count();
+  this->PendingAreaPickTime += this->AreaPickTime;
+  std::cout << __func__ << " selected "
+            << this->SelectedCells.GetNumberOfCells() << " cells of "
+            << this->SelectedCells.GetNumberOfBlocks() << " blocks in "
+            << this->AreaPickTime << "ms" << std::endl;
+}
+
+namespace {
+bool IsPolygon(int cellType) {
+  return cellType == VTK_TRIANGLE || cellType == VTK_QUAD ||
+         cellType == VTK_POLYGON;
+}
+
+bool IsInside(const BlockBVH::Frustum &frustum, const double x[3]) {
+  return std::all_of(frustum.begin(), frustum.end(), [x](const auto &plane) {
+    return plane[0] * x[0] + plane[1] * x[1] + plane[2] * x[2] + plane[3] >= 0;
+  });
+}
+
+// Builds the cells of the meshes up front, so that they can be read from
+// many threads.
+void PrepareBlockMeshes(const std::vector<vtkPolyData *> &meshes) {
+  for (auto mesh : meshes) {
+    if (mesh != nullptr && mesh->NeedToBuildCells()) {
+      mesh->BuildCells();
+    }
+  }
+}
+} // namespace
+
+void BenchmarkApp::SelectCellsInFrustum(const std::vector<vtkIdType> &blockIds,
+                                        const BlockBVH::Frustum &frustum) {
+  const vtkIdType numBlocks = static_cast<vtkIdType>(blockIds.size());
+  std::vector<int> levels(numBlocks);
+  std::vector<vtkPolyData *> meshes(numBlocks);
+  std::vector<std::array<double, 3>> translations(numBlocks);
+  for (vtkIdType i = 0; i < numBlocks; ++i) {
+    levels[i] = this->GetBlockLevel(blockIds[i]);
+    meshes[i] =
+        this->GetBlockMesh(blockIds[i], levels[i], translations[i].data());
+  }
+  ::PrepareBlockMeshes(meshes);
+  // a cell is selected when one of its points is inside the frustum.
+  std::vector<std::vector<std::uint32_t>> cells(numBlocks);
+  vtkSMPTools::For(0, numBlocks, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<unsigned char> inside;
+    vtkNew<vtkIdList> ptIds;
+    for (vtkIdType i = begin; i < end; ++i) {
+      auto mesh = meshes[i];
+      if (mesh == nullptr) {
+        continue;
+      }
+      const auto &t = translations[i];
+      inside.resize(mesh->GetNumberOfPoints());
+      for (vtkIdType ptId = 0; ptId < mesh->GetNumberOfPoints(); ++ptId) {
+        double x[3];
+        mesh->GetPoint(ptId, x);
+        vtkMath::Add(x, t.data(), x);
+        inside[ptId] = ::IsInside(frustum, x);
+      }
+      vtkIdType npts = 0;
+      const vtkIdType *pts = nullptr;
+      for (vtkIdType cellId = 0; cellId < mesh->GetNumberOfCells(); ++cellId) {
+        mesh->GetCellPoints(cellId, npts, pts, ptIds);
+        if (std::any_of(pts, pts + npts,
+                        [&inside](vtkIdType ptId) { return inside[ptId]; })) {
+          cells[i].push_back(static_cast<std::uint32_t>(cellId));
+        }
+      }
+    }
+  });
+  this->SelectedCells.Clear();
+  for (vtkIdType i = 0; i < numBlocks; ++i) {
+    if (!cells[i].empty()) {
+      this->SelectedCells.StartBlock(blockIds[i], levels[i]);
+      this->SelectedCells.AddCells(cells[i].data(), cells[i].size());
+    }
+  }
+  this->SelectedCells.Finalize();
+}
+
+vtkPolyData *BenchmarkApp::GetBlockMesh(vtkIdType blockId, int level,
+                                        double translation[3]) {
+  translation[0] = translation[1] = translation[2] = 0.0;
+  if (blockId < 0) {
+    return nullptr;
+  }
+  if (this->Strategy == RenderStrategy::Composite) {
+    const auto pdsIdx = static_cast<unsigned int>(blockId);
+    if (pdsIdx >= this->Meshes->GetNumberOfPartitionedDataSets()) {
+      return nullptr;
+    }
+    // loaded blocks have a single partition.
+    const unsigned int numPartitions =
+        this->Meshes->GetNumberOfPartitions(pdsIdx);
+    if (level < 0 || static_cast<unsigned int>(level) >= numPartitions) {
+      return nullptr;
+    }
+    return vtkPolyData::SafeDownCast(
+        this->Meshes->GetPartition(pdsIdx, static_cast<unsigned int>(level)));
+  }
+  const int layer = blockId % NumLayers;
+  const vtkIdType instanceId = blockId / NumLayers;
+  if (instanceId >= this->Instances[layer]->GetNumberOfPoints()) {
+    return nullptr;
+  }
+  this->Instances[layer]->GetPoint(instanceId, translation);
+  // merged layers are built from the finest level only.
+  if (this->Strategy == RenderStrategy::Merged) {
+    level = 0;
+  }
+  if (level < 0 || level >= NumLevelsOfDetail) {
+    return nullptr;
+  }
+  return this->Primitives[layer][level];
+}
+
+void BenchmarkApp::UpdateAreaSelectionMesh() {
+  const auto &blockIds = this->SelectedCells.GetBlockIds();
+  const auto &levels = this->SelectedCells.GetLevels();
+  const auto &offsets = this->SelectedCells.GetOffsets();
+  const auto &cellIds = this->SelectedCells.GetCellIds();
+  const vtkIdType numBlocks = static_cast<vtkIdType>(blockIds.size());
+  // the cell ids are of the level the block was picked at, which may no
+  // longer be the one it is drawn with.
+  std::vector<vtkPolyData *> meshes(numBlocks);
+  std::vector<std::array<double, 3>> translations(numBlocks);
+  for (vtkIdType i = 0; i < numBlocks; ++i) {
+    meshes[i] = this->GetBlockMesh(blockIds[i], static_cast<int>(levels[i]),
+                                   translations[i].data());
+  }
+  ::PrepareBlockMeshes(meshes);
+  // every selected polygon gets points of its own. the point and polygon
+  // counts of every block are summed first, so that the blocks are copied
+  // in parallel.
+  std::vector<vtkIdType> pointOffsets(numBlocks + 1, 0);
+  std::vector<vtkIdType> cellOffsets(numBlocks + 1, 0);
+  vtkSMPTools::For(0, numBlocks, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i) {
+      if (meshes[i] == nullptr) {
+        continue;
+      }
+      for (std::uint32_t j = offsets[i]; j < offsets[i + 1]; ++j) {
+        if (::IsPolygon(meshes[i]->GetCellType(cellIds[j]))) {
+          pointOffsets[i + 1] += meshes[i]->GetCellSize(cellIds[j]);
+          ++cellOffsets[i + 1];
+        }
+      }
+    }
+  });
+  std::partial_sum(pointOffsets.begin(), pointOffsets.end(),
+                   pointOffsets.begin());
+  std::partial_sum(cellOffsets.begin(), cellOffsets.end(),
+                   cellOffsets.begin());
+
+  vtkNew<vtkFloatArray> coords;
+  coords->SetNumberOfComponents(3);
+  coords->SetNumberOfTuples(pointOffsets.back());
+  vtkNew<vtkIdTypeArray> polyOffsets;
+  polyOffsets->SetNumberOfValues(cellOffsets.back() + 1);
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfValues(pointOffsets.back());
+  float *dstCoords = coords->GetPointer(0);
+  vtkIdType *dstOffsets = polyOffsets->GetPointer(0);
+  vtkIdType *dstConnectivity = connectivity->GetPointer(0);
+  vtkSMPTools::For(0, numBlocks, [&](vtkIdType begin, vtkIdType end) {
+    vtkNew<vtkIdList> ptIds;
+    for (vtkIdType i = begin; i < end; ++i) {
+      auto mesh = meshes[i];
+      if (mesh == nullptr) {
+        continue;
+      }
+      const auto &t = translations[i];
+      vtkIdType pointId = pointOffsets[i];
+      vtkIdType polyId = cellOffsets[i];
+      vtkIdType npts = 0;
+      const vtkIdType *pts = nullptr;
+      for (std::uint32_t j = offsets[i]; j < offsets[i + 1]; ++j) {
+        if (!::IsPolygon(mesh->GetCellType(cellIds[j]))) {
+          continue;
+        }
+        mesh->GetCellPoints(cellIds[j], npts, pts, ptIds);
+        dstOffsets[polyId++] = pointId;
+        for (vtkIdType k = 0; k < npts; ++k, ++pointId) {
+          double x[3];
+          mesh->GetPoint(pts[k], x);
+          for (int comp = 0; comp < 3; ++comp) {
+            dstCoords[3 * pointId + comp] =
+                static_cast<float>(x[comp] + t[comp]);
+          }
+          dstConnectivity[pointId] = pointId;
+        }
+      }
+    }
+  });
+  dstOffsets[cellOffsets.back()] = pointOffsets.back();
+
+  vtkNew<vtkPoints> points;
+  points->SetData(coords);
+  vtkNew<vtkCellArray> polys;
+  polys->SetData(polyOffsets, connectivity);
+  this->AreaSelectionMesh->Initialize();
+  this->AreaSelectionMesh->SetPoints(points);
+  this->AreaSelectionMesh->SetPolys(polys);
+}
+
+bool BenchmarkApp::IsBlockVisible(vtkIdType blockId) {
+  return blockId >= 0 && blockId < this->Attributes.GetNumberOfBlocks() &&
+         this->Attributes.GetVisibility(blockId);
+}
+
+bool BenchmarkApp::IsBlockDrawn(vtkIdType blockId) {
+  if (this->IsConstructionPending() &&
+      blockId >= this->NumberOfBuiltInstances * NumLayers) {
+    return false;
+  }
+  return this->IsBlockVisible(blockId) &&
+         (static_cast<std::size_t>(blockId) >= this->BlockCulled.size() ||
+          !this->BlockCulled[blockId]);
+}
+
+void BenchmarkApp::SetAreaPicker(AreaPicker picker) {
+  std::cout << __func__ << "("
+            << (picker == AreaPicker::BoundingVolumeHierarchy
+                    ? "BoundingVolumeHierarchy"
+                    : "HardwareSelector")
+            << ")" << std::endl;
+  this->AreaPickerType = picker;
+}
+
+double BenchmarkApp::GetAreaPickTime() { return this->AreaPickTime; }
+
+const CellSelection &BenchmarkApp::GetSelectedCells() {
+  return this->SelectedCells;
+}
+
+int BenchmarkApp::GetNumberOfSelectedCells() {
+  return static_cast<int>(this->SelectedCells.GetNumberOfCells());
+}
+
+std::vector<double> BenchmarkApp::GetFrameTimings() {
+  return this->Timer.GetSamples();
+}
+
+SummaryStatistics
+BenchmarkApp::GetFrameTimingStatistics(FrameTimer::Phase phase) {
+  return this->Timer.GetStatistics(phase);
+}
+
+SummaryStatistics BenchmarkApp::GetViewTimingStatistics(int view) {
+  return this->Timer.GetViewStatistics(view);
+}
+
+void BenchmarkApp::ClearFrameTimings() { this->Timer.Clear(); }
+
+void BenchmarkApp::SetFrameTimingsCapacity(int numFrames) {
+  std::cout << __func__ << "(" << numFrames << ")" << std::endl;
+  this->Timer.SetCapacity(static_cast<std::size_t>(std::max(numFrames, 1)));
+}
+
+void BenchmarkApp::StartRecording() {
+  std::cout << __func__ << std::endl;
+  this->RecordedInput.events.clear();
+  this->RecordingInput = true;
+  this->RecordingStartTime = std::chrono::steady_clock::now();
+  // the state the first events apply to.
+  this->RecordWindowSize();
+  InputRecording::Event pick;
+  pick.kind = InputRecording::Pick;
+  pick.pick = ::PickTypeNames[this->CurrentPickType];
+  this->RecordEvent(std::move(pick));
+  this->RecordCamera();
+}
+
+std::string BenchmarkApp::StopRecording() {
+  std::cout << __func__ << std::endl;
+  if (!this->RecordingInput) {
+    return std::string();
+  }
+  this->RecordingInput = false;
+  std::cout << "Recorded " << this->RecordedInput.events.size()
+            << " events in " << this->RecordedInput.GetDuration() << "ms"
+            << std::endl;
+  const std::string text = this->RecordedInput.ToString();
+  this->RecordedInput.events.clear();
+  return text;
+}
+
+bool BenchmarkApp::IsRecording() { return this->RecordingInput; }
+
+bool BenchmarkApp::InputHandler(vtkObject *, unsigned long eventId, void *) {
+  // a replay only sees the events of its recording. the window size still
+  // follows the page.
+  if (this->Replaying && !this->DispatchingReplay &&
+      eventId != vtkCommand::ConfigureEvent) {
+    return true;
+  }
+  if (!this->RecordingInput) {
+    return false;
+  }
+  if (eventId == vtkCommand::ConfigureEvent) {
+    this->RecordWindowSize();
+    return false;
+  }
+  InputRecording::Event event;
+  event.eventId = eventId;
+  const int *position = this->Interactor->GetEventPosition();
+  event.position = {position[0], position[1]};
+  event.modifiers =
+      (this->Interactor->GetControlKey() ? InputRecording::Control : 0) |
+      (this->Interactor->GetShiftKey() ? InputRecording::Shift : 0) |
+      (this->Interactor->GetAltKey() ? InputRecording::Alt : 0);
+  event.repeatCount = this->Interactor->GetRepeatCount();
+  event.keyCode = static_cast<unsigned char>(this->Interactor->GetKeyCode());
+  if (const char *keySym = this->Interactor->GetKeySym()) {
+    event.keySym = keySym;
+  }
+  this->RecordEvent(std::move(event));
+  return false;
+}
+
+void BenchmarkApp::RecordEvent(InputRecording::Event event) {
+  // the events a replay dispatches are already in its recording.
+  if (!this->RecordingInput || this->Replaying) {
+    return;
+  }
+  event.time = std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - this->RecordingStartTime)
+                   .count();
+  this->RecordedInput.events.push_back(std::move(event));
+}
+
+void BenchmarkApp::RecordWindowSize() {
+  if (!this->RecordingInput) {
+    return;
+  }
+  InputRecording::Event event;
+  event.kind = InputRecording::Size;
+  const int *size = this->Window->GetSize();
+  event.position = {size[0], size[1]};
+  this->RecordEvent(std::move(event));
+}
+
+void BenchmarkApp::RecordCamera() {
+  if (!this->RecordingInput) {
+    return;
+  }
+  const CameraState state = this->GetCameraState();
+  InputRecording::Event event;
+  event.kind = InputRecording::Camera;
+  std::copy(state.position, state.position + 3, event.camera.begin());
+  std::copy(state.focalPoint, state.focalPoint + 3, event.camera.begin() + 3);
+  std::copy(state.viewUp, state.viewUp + 3, event.camera.begin() + 6);
+  event.camera[9] = state.viewAngle;
+  this->RecordEvent(std::move(event));
+}
+
+int BenchmarkApp::StartReplay(const std::string &text, double timestep) {
+  std::cout << __func__ << "(" << text.size() << ',' << timestep << ")"
+            << std::endl;
+  std::string error;
+  if (timestep <= 0 ||
+      !InputRecording::Parse(text, this->ReplayedInput, error)) {
+    std::cerr << "Invalid recording, " << error << std::endl;
+    return 0;
+  }
+  if (this->IsConstructionPending()) {
+    // chunks are sized from the measured build time, replays start from the
+    // whole scene instead.
+    this->BuildCompositeBlocks(this->NumberOfInstances);
+    this->FinishConstruction();
+  }
+  this->ReplayTimestep = timestep;
+  this->NextReplayedEvent = 0;
+  this->ReplayFrame = 0;
+  this->NumberOfReplayFrames =
+      static_cast<int>(this->ReplayedInput.GetDuration() / timestep) + 1;
+  this->Replaying = true;
+  // hover picks run once per step, a timer would pick in between.
+  this->HoverStyle->SetPickTimer(false);
+  // the statistics cover the replay only.
+  const auto numFrames =
+      static_cast<std::size_t>(this->NumberOfReplayFrames);
+  if (this->Timer.GetCapacity() < numFrames) {
+    this->Timer.SetCapacity(numFrames);
+  }
+  this->Timer.Clear();
+  return this->NumberOfReplayFrames;
+}
+
+bool BenchmarkApp::StepReplay() {
+  if (!this->Replaying) {
+    return false;
+  }
+  const auto &events = this->ReplayedInput.events;
+  const double end = (this->ReplayFrame + 1) * this->ReplayTimestep;
+  this->DispatchingReplay = true;
+  while (this->NextReplayedEvent < events.size() &&
+         events[this->NextReplayedEvent].time < end) {
+    this->DispatchEvent(events[this->NextReplayedEvent++]);
   }
+  this->DispatchingReplay = false;
+  // hover picks wait for a timer, the step picks at its last position.
+  this->HoverStyle->FlushPendingPick();
+  ++this->ReplayFrame;
   this->Window->Render();
+  if (this->ReplayFrame < this->NumberOfReplayFrames) {
+    return true;
+  }
+  this->Replaying = false;
+  this->HoverStyle->SetPickTimer(true);
+  const auto stats = this->Timer.GetStatistics(FrameTimer::Total);
+  std::cout << "Replayed " << events.size() << " events in "
+            << this->ReplayFrame << " frames, p50=" << stats.p50
+            << "ms p95=" << stats.p95 << "ms" << std::endl;
+  return false;
+}
+
+void BenchmarkApp::PlayReplay() {
+#ifdef __EMSCRIPTEN__
+  emscripten_request_animation_frame(
+      [](double, void *self) -> EM_BOOL {
+        auto app = static_cast<BenchmarkApp *>(self);
+        if (app->StepReplay()) {
+          app->PlayReplay();
+        }
+        return EM_FALSE;
+      },
+      this);
+#else
+  while (this->StepReplay()) {
+  }
+#endif
+}
+
+bool BenchmarkApp::IsReplaying() { return this->Replaying; }
+
+int BenchmarkApp::DispatchInput(const std::string &text) {
+  InputRecording input;
+  std::string error;
+  if (!InputRecording::Parse(text, input, error)) {
+    std::cerr << "Invalid input, " << error << std::endl;
+    return -1;
+  }
+  for (const auto &event : input.events) {
+    this->DispatchEvent(event);
+  }
+  return static_cast<int>(input.events.size());
+}
+
+void BenchmarkApp::DispatchEvent(const InputRecording::Event &event) {
+  switch (event.kind) {
+  case InputRecording::Size:
+    this->Interactor->UpdateSize(event.position[0], event.position[1]);
+    break;
+  case InputRecording::Pick:
+    for (int pickType = Area; pickType <= None; ++pickType) {
+      if (event.pick == ::PickTypeNames[pickType]) {
+        this->SetPickType(PickType(pickType));
+      }
+    }
+    break;
+  case InputRecording::Camera: {
+    CameraState state;
+    std::copy_n(event.camera.begin(), 3, state.position);
+    std::copy_n(event.camera.begin() + 3, 3, state.focalPoint);
+    std::copy_n(event.camera.begin() + 6, 3, state.viewUp);
+    state.viewAngle = event.camera[9];
+    this->SetCameraState(state);
+    break;
+  }
+  default:
+    // the interactor styles receive it like an event of the platform.
+    this->Interactor->SetEventInformation(
+        event.position[0], event.position[1],
+        (event.modifiers & InputRecording::Control) != 0,
+        (event.modifiers & InputRecording::Shift) != 0,
+        static_cast<char>(event.keyCode), event.repeatCount,
+        event.keySym.empty() ? nullptr : event.keySym.c_str());
+    this->Interactor->SetAltKey((event.modifiers & InputRecording::Alt) != 0);
+    this->Interactor->InvokeEvent(event.eventId);
+  }
 }
 
 #ifdef __EMSCRIPTEN__
-#include <chrono>
 #include <emscripten.h>
 namespace {
 EM_JS(void, call_tick, (int now), { tick(now); });
 } // namespace
 #endif
 
+namespace {
+// True while a vtkHardwareSelector renders its selection passes, in any of
+// the views.
+bool IsSelectionPass(vtkRenderWindow *window) {
+  auto renderers = window->GetRenderers();
+  vtkCollectionSimpleIterator it;
+  renderers->InitTraversal(it);
+  while (auto ren = renderers->GetNextRenderer(it)) {
+    if (ren->GetSelector() != nullptr) {
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace
+
+void BenchmarkApp::StartRenderHandler(vtkObject *, unsigned long, void *) {
+  if (::IsSelectionPass(this->Window)) {
+    this->FlushBlockAttributes();
+    return;
+  }
+  this->RenderDirty = false;
+  ++this->NumberOfRenders;
+  this->Timer.StartFrame();
+  this->UpdateRenderQuality();
+  this->Timer.SetQuality(this->FrameQuality);
+  // picks that happened since the previous frame.
+  const double hoverPickTime = this->HoverStyle->GetTotalPickTime();
+  this->Timer.Add(FrameTimer::Pick, hoverPickTime -
+                                        this->ChargedHoverPickTime +
+                                        this->PendingAreaPickTime);
+  this->ChargedHoverPickTime = hoverPickTime;
+  this->PendingAreaPickTime = 0;
+
+  // bring the pipeline up to date here, so that the render only builds
+  // buffers and draws.
+  this->ConstructionFrame = this->IsConstructionPending();
+  this->ContinueConstruction();
+  this->UpdateFrustumCulling();
+  this->UpdateLevelsOfDetail();
+  this->FlushBlockAttributes();
+  vtkMTimeType mtime = std::max(this->Meshes->GetMTime(),
+                                this->DisplayAttributes->GetMTime());
+  mtime = std::max(mtime, this->Actor->GetProperty()->GetMTime());
+  mtime = std::max(mtime, this->AreaSelectionMesh->GetMTime());
+  if (auto mapper = this->Actor->GetMapper()) {
+    mapper->Update();
+    mtime = std::max(mtime, mapper->GetMTime());
+  }
+  for (int layer = 0; layer < NumLayers; ++layer) {
+    if (auto mapper = this->InstancedActors[layer]->GetMapper()) {
+      mapper->Update();
+      mtime = std::max(mtime, mapper->GetMTime());
+      mtime = std::max(mtime, this->Instances[layer]->GetMTime());
+    }
+    if (auto mapper = this->MergedActors[layer]->GetMapper()) {
+      mapper->Update();
+      mtime = std::max(mtime, mapper->GetMTime());
+      mtime = std::max(mtime, this->MergedMeshes[layer]->GetMTime());
+    }
+  }
+  // the mappers rebuild their buffers when anything they upload changed.
+  this->MappersRebuilt = mtime > this->RenderedMTime;
+  this->RenderedMTime = mtime;
+  this->Timer.Lap(FrameTimer::Update);
+}
+
+void BenchmarkApp::StartViewHandler(vtkObject *, unsigned long, void *) {
+  this->ViewStartTime = std::chrono::steady_clock::now();
+}
+
+void BenchmarkApp::EndViewHandler(vtkObject *caller, unsigned long, void *) {
+  if (!this->Timer.IsFrameStarted() || ::IsSelectionPass(this->Window)) {
+    return;
+  }
+  for (std::size_t view = 0; view < this->Views.size(); ++view) {
+    if (this->Views[view].Get() == caller) {
+      this->TranslucencyTime +=
+          this->TranslucencyPasses[view]->PopElapsedTime();
+      this->Timer.AddViewTime(
+          static_cast<int>(view),
+          std::chrono::duration<double, std::milli>(
+              std::chrono::steady_clock::now() - this->ViewStartTime)
+              .count());
+    }
+  }
+}
+
 // Called after area picker finished.
 void BenchmarkApp::EndRenderHandler(vtkObject *, unsigned long, void *) {
   std::cout << __func__ << std::endl;
+  const bool timed =
+      this->Timer.IsFrameStarted() && !::IsSelectionPass(this->Window);
+  if (timed) {
+    // the render time is charged to buffer building when the mappers had
+    // to rebuild, and to draw submission otherwise.
+    const auto phase = this->MappersRebuilt ? FrameTimer::MapperBuild
+                                            : FrameTimer::DrawSubmission;
+    this->Timer.Lap(phase);
+    // the translucent passes ran inside the render, their time is moved out
+    // of it.
+    this->Timer.Add(phase, -this->TranslucencyTime);
+    this->Timer.Add(FrameTimer::Translucency, this->TranslucencyTime);
+  }
+  this->TranslucencyTime = 0;
+  if (this->GPUWaitTiming) {
+    this->Window->WaitForCompletion();
+  }
+  if (timed) {
+    this->Timer.Lap(FrameTimer::GPUWait);
+    this->Timer.EndFrame();
+    this->SampleHeapUsage();
+    if (this->ConstructionFrame) {
+      this->AddConstructionFrame(
+          this->Timer.GetLastFrame()[FrameTimer::Total]);
+    }
+    if (this->StartupTimes[StartupPhase::SceneReady] >= 0) {
+      this->MarkStartup(StartupPhase::FirstFrame);
+    }
+    // a full quality frame once no reduced frame followed for a while.
+    if (this->RefineTimerId >= 0) {
+      this->Interactor->DestroyTimer(this->RefineTimerId);
+      this->RefineTimerId = -1;
+    }
+    if (this->FrameQuality != RenderQuality::Full && !this->Replaying &&
+        this->Interactor->GetInitialized()) {
+      this->RefineTimerId =
+          this->Interactor->CreateOneShotTimer(::RefineDelay);
+    }
+  }
 #ifdef __EMSCRIPTEN__
-  this->Window->WaitForCompletion();
   using namespace std;
   const auto now = chrono::duration_cast<chrono::milliseconds>(
                        chrono::steady_clock::now().time_since_epoch())
@@ -1,18 +1,36 @@
 #pragma once
 
+#include "BlockAttributes.h"
+#include "BlockBVH.h"
+#include "CellSelection.h"
+#include "FrameTimer.h"
 #include "HoverPickStyle.h"
+#include "InputRecording.h"
+#include "SceneCache.h"
+#include "SceneDescription.h"
+#include "TranslucencyPass.h"
 
 #include <vtkActor.h>
 #include <vtkCameraOrientationRepresentation.h>
 #include <vtkCameraOrientationWidget.h>
 #include <vtkCompositeDataDisplayAttributes.h>
+#include <vtkFloatArray.h>
 #include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
 #include <vtkInteractorStyleSwitch.h>
+#include <vtkPolyData.h>
 #include <vtkRenderWindow.h>
 #include <vtkRenderWindowInteractor.h>
+#include <vtkRenderer.h>
+#include <vtkSmartPointer.h>
 #include <vtkVector.h>
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 class CameraState {
 public:
@@ -22,6 +40,30 @@ public:
   double viewAngle;
 };
 
+// Number of primitives submitted for the visible blocks in one frame.
+struct PrimitiveCounts {
+  long long triangles = 0;
+  long long lines = 0;
+  long long points = 0;
+};
+
+// Memory use in bytes. Arrays shared by many blocks are counted once.
+struct MemoryStats {
+  // reserved by the allocator (the linear memory in wasm) and allocated.
+  double heapSize = 0;
+  double heapUsed = 0;
+  // largest heapUsed seen after creating the datasets or rendering.
+  double heapHighWaterMark = 0;
+  double points = 0;
+  double cells = 0;
+  // per-cell colors of the blocks and per-instance colors.
+  double colors = 0;
+  double otherArrays = 0;
+  // estimate of the vertex, index and instance buffers uploaded by the
+  // mappers for the visible blocks.
+  double gpuBuffers = 0;
+};
+
 class BenchmarkApp {
 public:
   BenchmarkApp();
@@ -29,39 +71,478 @@ public:
 
   enum PickType { Area, Hover, None };
   enum LayerID { Cone = 0, Sphere, Cylinder, NumLayers };
+  // Composite: every block is a separate mesh drawn by one
+  // vtkCompositePolyDataMapper2.
+  // Instanced: one mesh per layer, drawn once per block with a
+  // vtkGlyph3DMapper.
+  // Merged: the blocks of a layer are merged into one mesh, drawn by one
+  // vtkPolyDataMapper per layer.
+  enum RenderStrategy { Composite = 0, Instanced, Merged };
+  // HardwareSelector: renders the scene in selection passes and reads back
+  // the pixels under the rubber band.
+  // BoundingVolumeHierarchy: intersects the rubber band frustum with the
+  // block bounds on the CPU.
+  enum AreaPicker { HardwareSelector = 0, BoundingVolumeHierarchy };
+  // Full: the representation, line width and point size as set.
+  // Reduced: no edges, one pixel wide lines and points, and blocks must be
+  // twice as large on screen to get the same level of detail.
+  // Coarse: reduced, with every block at the coarsest level of detail.
+  enum RenderQuality { Full = 0, Reduced, Coarse };
+  // DepthPeeling: dual depth peeling, exact up to the peel limit.
+  // OrderIndependent: weighted blended transparency in a single pass,
+  // approximate where translucent surfaces overlap.
+  enum TranslucencyTechnique {
+    DepthPeeling = TranslucencyPass::DepthPeeling,
+    OrderIndependent = TranslucencyPass::OrderIndependent
+  };
+  // Startup milestones: the app was constructed, initialized, its first
+  // scene is complete and the first frame of it was rendered.
+  enum StartupPhase {
+    Constructed = 0,
+    Initialized,
+    SceneReady,
+    FirstFrame,
+    NumberOfStartupPhases
+  };
+  // Every primitive is tessellated at these many resolutions, finest first.
+  static constexpr int NumLevelsOfDetail = 3;
 
-  void LoadFileFromBinary(const std::string& contents);
-  void LoadFile(const std::string& filename);
+  // Reads a VTP, STL or OBJ file from a buffer allocated with malloc. The
+  // buffer is read in place and freed by this call. `filename` is only used
+  // to detect the format. Returns the number of objects.
+  int LoadFileFromBinary(std::uintptr_t buffer, std::size_t size,
+                         const std::string &filename);
+  // Reads a VTP, VTM, STL or OBJ file. Returns the number of objects.
+  int LoadFile(const std::string &filename);
+  // Binary snapshot of the composite blocks, see SceneCache. It is kept
+  // until ReleaseSceneCache. Returns its size, 0 while there is no complete
+  // composite scene to write.
+  std::size_t WriteSceneCache();
+  std::uintptr_t GetSceneCacheData();
+  void ReleaseSceneCache();
+  bool SaveSceneCache(const std::string &filename);
+  // Reads a snapshot memory-mapped from a file, or in place from a buffer
+  // allocated with malloc that is freed by the app. The arrays of the blocks
+  // point into it until the next scene. Returns the number of objects, 0 when
+  // it is not a snapshot of this version.
+  int LoadSceneCache(const std::string &filename);
+  int LoadSceneCacheFromBinary(std::uintptr_t buffer, std::size_t size);
+  // Wall time and size of the last loaded file in milliseconds and bytes.
+  double GetLoadTime();
+  double GetLoadedBytes();
+  // Drops the selected cells, the block color overrides are kept.
   void ClearSelections();
+  // Creates an nx * ny grid of the default scene.
   int CreateDatasets(int nx, int ny);
+  // Generates the blocks of a scene. Returns the number of objects.
+  int CreateScene(const SceneDescription &scene);
+  // Parses a scene description, see SceneDescription for the format, and
+  // creates it. Returns the number of objects, 0 when it is invalid.
+  int LoadScene(const std::string &text);
+  int LoadSceneFile(const std::string &filename);
+  // Description of the generated scene, empty after loading a file.
+  std::string GetSceneDescription();
+  // Spreads the creation of composite scenes over the next frames. Every
+  // render first builds blocks for about `budget` ms, the blocks built so far
+  // are drawn. 0 builds the whole scene in CreateScene.
+  void SetConstructionBudget(double budget);
+  // Fraction of the instances of the scene built so far.
+  double GetConstructionProgress();
+  bool IsConstructionPending();
+  // Mean time in ms of the frames rendered while the last scene was built,
+  // with the chunks built in them. 0 when it was built at once.
+  double GetConstructionFrameTime();
+  // Wall time of the last CreateScene call in milliseconds.
+  double GetDatasetsGenerationTime();
   void Initialize();
+  void InitializeView();
+  // True when built with threads, the wasm build only has them in the
+  // ENABLE_THREADS variant.
+  bool IsMultithreaded();
+  // vtkSMPTools backend and the number of threads it runs on.
+  std::string GetSMPBackend();
+  int GetNumberOfThreads();
+  // Renders right away.
   void Render();
+  // Marks the scene dirty. It is rendered once on the next animation frame,
+  // or timer tick on desktop, however many requests come in until then.
+  // Renders requested by the interactor and its styles go through here too.
+  void RequestRender();
+  // Frames rendered, render requests, requests merged into an already
+  // pending render and scheduled renders that found nothing left to draw.
+  int GetNumberOfRenders();
+  int GetNumberOfRenderRequests();
+  int GetNumberOfCoalescedRenders();
+  int GetNumberOfSkippedRenders();
+  void WaitForCompletion();
   void ResetView();
   int Run();
   void SetEdgeColor(float r, float g, float b);
   void SetLayerVisibility(LayerID layer, bool visible);
+  // Batched block updates, applied to the mappers on the next render. Ranges
+  // are [begin, end) in block ids. Bitsets are arrays of uint32 words with one
+  // bit per block, they stay owned by the caller.
+  void SetBlocksVisibility(int begin, int end, bool visible);
+  void SetBlocksVisibilityFromBitset(std::uintptr_t bits, int numBlocks,
+                                     bool visible);
+  void SetBlocksColor(int begin, int end, float r, float g, float b);
+  void SetBlocksColorFromBitset(std::uintptr_t bits, int numBlocks, float r,
+                                float g, float b);
+  void RemoveBlocksColor(int begin, int end);
+  int GetNumberOfBlocks();
   void SetLineWidth(float width);
   void SetPickType(PickType pickType);
+  void SetAreaPicker(AreaPicker picker);
   void SetScrollSensitivity(float sensitivity);
   void SetPointSize(float size);
   void SetRepresentation(int representation);
+  void SetRenderStrategy(RenderStrategy strategy);
+  // Loaded files always use the Composite strategy.
+  RenderStrategy GetRenderStrategy();
+  // Picks the resolution of every block from its size on screen, before
+  // every frame. Off: always the finest resolution.
+  void SetLevelOfDetail(bool enabled);
+  // Skips the blocks outside of the view frustum before every frame. Their
+  // visibility as set by the user is left as is.
+  void SetFrustumCulling(bool enabled);
+  // Splits the window into 1 to FrameTimer::MaxViews views, in a row or 2x2
+  // for 4. The views draw the same actors, so the meshes and their GPU
+  // buffers are shared, each with its own camera. New views start from the
+  // camera of the first one turned around the focal point. Blocks take the
+  // level of detail of the view they are largest in and are culled when
+  // outside of every view. Bookmarks, recordings and hover picks use the
+  // first view.
+  void SetNumberOfViews(int count);
+  int GetNumberOfViews();
+  // Frames rendered while the camera moves drop to the reduced quality, or
+  // to the coarse one while the previous frame took longer than `budget` ms,
+  // until a frame takes less than half of it. A full quality frame follows
+  // once the interaction ends, or when a drag pauses for 150 ms.
+  // Off: every frame is at full quality.
+  void SetInteractionQuality(bool enabled);
+  void SetInteractionFrameBudget(double budget);
+  // Quality of the last frame, and of the frames in the timings oldest first.
+  RenderQuality GetFrameQuality();
+  std::vector<int> GetFrameQualities();
+  // Blocks skipped in the last frame and time spent finding them in ms.
+  int GetNumberOfCulledBlocks();
+  double GetCullingTime();
   void SetSelectedBlockColor(float r, float g, float b);
+  // Opacity of the blocks of a layer, and of the blocks colored by
+  // SetBlocksColor, which replaces the layer opacity of those blocks.
+  // Applied on the next render. Blocks with an opacity below 1 are drawn by
+  // the translucency technique.
+  void SetLayerOpacity(LayerID layer, double opacity);
+  void SetSelectedBlockOpacity(double opacity);
+  void SetTranslucencyTechnique(TranslucencyTechnique technique);
+  // Peel limit of depth peeling, 0 peels until every layer is drawn.
+  void SetMaximumNumberOfPeels(int peels);
+  // Waits for the GPU at the end of every frame, and around the translucent
+  // passes, so that the GPU time is measured. The wait stalls the pipeline,
+  // so it is only on by default in the browser. Benchmarks turn it on.
+  void SetGPUWaitTiming(bool enabled);
   CameraState GetCameraState();
   void SetCameraState(CameraState &state);
   void SetShowCameraManipulator(bool show);
+  void SetOffScreenRendering(bool offscreen);
+  void SetWindowSize(int width, int height);
+  void OrbitCamera(double azimuth);
+  PrimitiveCounts GetPrimitiveCounts();
+  // Memory held by the datasets in KiB. Shared arrays are counted once.
+  unsigned long GetDatasetsMemorySize();
+  MemoryStats GetMemoryStats();
+  void PrintMemoryStats();
+  // Time a startup phase was reached, in ms since the page started loading,
+  // or since the program was loaded on desktop. -1 until it is reached.
+  double GetStartupTime(StartupPhase phase);
+  static const char *GetStartupPhaseName(StartupPhase phase);
+  // Printed once the first frame is rendered.
+  void PrintStartupTimes();
+
+  // Programmatic picks, used by the headless benchmark runner.
+  void AreaPick(int x0, int y0, int x1, int y1);
+  void HoverPick(int x, int y);
+  // Time spent in the last area pick, in milliseconds.
+  double GetAreaPickTime();
+  // Cells picked by the last area pick in every block, drawn over the blocks
+  // in the selected block color until ClearSelections. The hardware selector
+  // picks the visible cells, or whole instances with the Instanced strategy.
+  // The bounding volume hierarchy picks the cells with a point inside the
+  // rubber band, occluded or not.
+  const CellSelection &GetSelectedCells();
+  int GetNumberOfSelectedCells();
+  // Time spent in hover picks since the last call, in milliseconds.
+  double GetHoverPickTime();
+
+  // Phase times of the last frames, oldest first, FrameTimer::NumberOfPhases
+  // values per frame in milliseconds.
+  std::vector<double> GetFrameTimings();
+  SummaryStatistics GetFrameTimingStatistics(FrameTimer::Phase phase);
+  // Time spent rendering one view per frame. The GPU wait of the frame is
+  // shared by all views and not included.
+  SummaryStatistics GetViewTimingStatistics(int view);
+  void ClearFrameTimings();
+  void SetFrameTimingsCapacity(int numFrames);
+
+  // Records the interactor events, and the window size, pick type and camera
+  // changes made through the app, see InputRecording.
+  void StartRecording();
+  // Stops recording and returns the recording, empty when not recording.
+  std::string StopRecording();
+  bool IsRecording();
+  // Loads a recording to replay. The events are dispatched in steps of
+  // `timestep` ms of recorded time and every step renders one frame, however
+  // long the frames take, so every replay of a recording renders the same
+  // frames. Returns the number of frames, 0 when the text is invalid.
+  int StartReplay(const std::string &text, double timestep);
+  // Dispatches the events of the next step and renders. Returns false once
+  // the replay is over.
+  bool StepReplay();
+  // Steps through the whole replay, one step per animation frame in the
+  // browser.
+  void PlayReplay();
+  bool IsReplaying();
+  // Dispatches the events of a recording right away, their times are
+  // ignored. The page forwards the input of its canvas to an app rendering
+  // in a worker this way. Returns the number of events, -1 when the text is
+  // invalid.
+  int DispatchInput(const std::string &text);
 
 protected:
   void EndPickHandler(vtkObject *, unsigned long, void *);
   void EndRenderHandler(vtkObject *, unsigned long, void *);
+  void StartRenderHandler(vtkObject *, unsigned long, void *);
+  void StartViewHandler(vtkObject *, unsigned long, void *);
+  void EndViewHandler(vtkObject *, unsigned long, void *);
+  void RenderTimerHandler(vtkObject *, unsigned long, void *);
+  // Records the input, and drops the live input during replays. Returns
+  // true to abort the event.
+  bool InputHandler(vtkObject *, unsigned long, void *);
+  void RecordEvent(InputRecording::Event event);
+  void RecordWindowSize();
+  void RecordCamera();
+  void DispatchEvent(const InputRecording::Event &event);
+  // Renders if the scene is still dirty when the scheduled frame comes.
+  void RenderIfDirty();
+
+  void AddActors(vtkRenderer *ren);
+  // Places the views in the window.
+  void UpdateViewports();
+  // Camera of the first view turned around its focal point by the share of
+  // a full turn of `view`.
+  void InitializeViewCamera(int view);
+  // View under a display position, the first one outside of all of them.
+  vtkRenderer *GetViewAt(int x, int y);
+  void AreaPickWithBVH(int x0, int y0, int x1, int y1);
+  void AreaPickWithHardwareSelector(int x0, int y0, int x1, int y1);
+  // Pushes the blocks changed since the last render to the mappers.
+  void FlushBlockAttributes();
+  // Shows the current level of detail of a composite block with its
+  // visibility and color. The other levels are hidden.
+  void ApplyBlockDisplay(vtkIdType blockId);
+  // Opacity of a block from its layer, or the selected block opacity when
+  // its color is overridden. Loaded blocks have no layer and are opaque.
+  double GetBlockOpacity(vtkIdType blockId);
+  // Gives `ren` the translucent pass of the current technique.
+  void AddTranslucencyPass(vtkRenderer *ren);
+  vtkIdType GetBlockIdFromCompositeIndex(unsigned int flatIdx);
+  // Creates the composite blocks of the next instances, up to `end`.
+  void BuildCompositeBlocks(vtkIdType end);
+  // Builds the next chunk of a pending construction within the budget.
+  void ContinueConstruction();
+  // Bounds and memory figures of the complete scene.
+  void FinishConstruction();
+  // Counts a frame rendered while the scene was built.
+  void AddConstructionFrame(double frameTime);
+  // Rebuilds the cells of a merged layer from its visible blocks.
+  void BuildMergedLayer(int layer);
+  // Writes the color of the n-th drawn block of a merged layer into its
+  // cells.
+  void ApplyMergedBlockColor(int layer, vtkIdType n);
+  // Adds cells of the merged mesh of a layer to the selected cells.
+  void SelectMergedCells(int layer, const vtkIdType *cellIds,
+                         vtkIdType numCells);
+  // Selects the cells of the blocks with a point inside the frustum.
+  void SelectCellsInFrustum(const std::vector<vtkIdType> &blockIds,
+                            const BlockBVH::Frustum &frustum);
+  // Mesh of a block at a level of detail, the translation of the instance,
+  // if any, is added to its points. Merged blocks only have level 0. Null
+  // when the block or the level does not exist.
+  vtkPolyData *GetBlockMesh(vtkIdType blockId, int level,
+                            double translation[3]);
+  // Copies the selected polygons into the mesh of the selection actor.
+  void UpdateAreaSelectionMesh();
+  void UpdateLevelsOfDetail();
+  void UpdateFrustumCulling();
+  // Picks the quality of the next frame and applies it to the property.
+  void UpdateRenderQuality();
+  void ApplyRenderQuality();
+  bool IsBlockVisible(vtkIdType blockId);
+  // Blocks of the layer drawn at the given level of detail.
+  vtkIdType CountDrawnBlocks(LayerID layer, int level);
+  // Visible and inside the view frustum.
+  bool IsBlockDrawn(vtkIdType blockId);
+  int GetBlockLevel(vtkIdType blockId);
+  double EstimateGPUBufferSize();
+  // Counts the cells and vertex bytes of the composite meshes once for the
+  // current representation, GetMeshSize reads them back.
+  void UpdateMeshSizes();
+  struct MeshSize {
+    PrimitiveCounts counts;
+    double vertexBytes = 0;
+    double colorBytes = 0;
+  };
+  const MeshSize &GetMeshSize(vtkIdType blockId, int level);
+  // Updates the heap figures and the high-water mark.
+  void SampleHeapUsage();
+  void UpdateDatasetsMemoryStats();
+  void UpdateBlockBounds();
+  int SetLoadedDataObject(vtkDataObject *dobj, std::size_t bytes,
+                          std::chrono::steady_clock::time_point startTime);
+  int SetSceneCache(std::unique_ptr<SceneCache::Buffer> buffer,
+                    std::chrono::steady_clock::time_point startTime);
+  // Empties the meshes and the per-block state of every strategy.
+  void ClearScene();
+  void UpdateMappers();
+  // Records the first time `phase` is reached.
+  void MarkStartup(StartupPhase phase);
 
 private:
   vtkNew<vtkIdList> BlockIdsPerLayer[NumLayers];
   vtkVector3d SelectedBlockColor;
+  double SelectedBlockOpacity = 1;
+  double LayerOpacities[NumLayers] = {1, 1, 1};
+  TranslucencyTechnique Translucency = TranslucencyTechnique::DepthPeeling;
+  int MaximumNumberOfPeels = 4;
+#ifdef __EMSCRIPTEN__
+  bool GPUWaitTiming = true;
+#else
+  bool GPUWaitTiming = false;
+#endif
   float ScrollSensitivity;
+  int Representation = 3; // Surface with edges.
+  float LineWidth = 1;
+  float PointSize = 1;
+  double DatasetsGenerationTime = 0;
+  double LoadTime = 0;
+  double LoadedBytes = 0;
+  unsigned long EndPickObserverTag = 0;
+  PickType CurrentPickType = PickType::None;
+  // Input recording and replay.
+  InputRecording RecordedInput;
+  bool RecordingInput = false;
+  std::chrono::steady_clock::time_point RecordingStartTime;
+  InputRecording ReplayedInput;
+  bool Replaying = false;
+  // true while a replay step dispatches its events.
+  bool DispatchingReplay = false;
+  double ReplayTimestep = 0;
+  std::size_t NextReplayedEvent = 0;
+  int ReplayFrame = 0;
+  int NumberOfReplayFrames = 0;
+  // Render scheduler state.
+  bool RenderDirty = false;
+  bool RenderScheduled = false;
+  int RenderTimerId = -1;
+  int NumberOfRenders = 0;
+  int NumberOfRenderRequests = 0;
+  int NumberOfCoalescedRenders = 0;
+  int NumberOfSkippedRenders = 0;
+  double StartupTimes[NumberOfStartupPhases] = {-1, -1, -1, -1};
 
   vtkNew<vtkCameraOrientationWidget> CamManipulator;
+  // Renderers of the split window, the first one is created by Initialize.
+  // The camera widget adds a renderer of its own to the window.
+  std::vector<vtkSmartPointer<vtkRenderer>> Views;
+  // Translucent pass of every view, and its time in the current frame.
+  std::vector<vtkSmartPointer<TranslucencyPass>> TranslucencyPasses;
+  double TranslucencyTime = 0;
+  std::chrono::steady_clock::time_point ViewStartTime;
 
   vtkNew<vtkPartitionedDataSetCollection> Meshes;
+  RenderStrategy Strategy = RenderStrategy::Composite;
+  SceneDescription Scene;
+  // false when the blocks come from a loaded file.
+  bool SceneCreated = false;
+  // Incremental construction. The blocks of the first NumberOfBuiltInstances
+  // instances are in Meshes, the centers are kept until all of them are.
+  double ConstructionBudget = 0;
+  vtkIdType NumberOfInstances = 0;
+  vtkIdType NumberOfBuiltInstances = 0;
+  // Blocks of the instances from NumberOfBuiltInstances up to
+  // NumberOfStagedInstances, built but not in Meshes yet, every level of
+  // every layer of an instance in a row.
+  vtkIdType NumberOfStagedInstances = 0;
+  std::vector<vtkSmartPointer<vtkPolyData>> StagedBlocks;
+  // Frames rendered while the scene was built, times in ms.
+  bool ConstructionFrame = false;
+  double ConstructionFrameTime = 0;
+  double MaxConstructionFrameTime = 0;
+  int NumberOfConstructionFrames = 0;
+  double InstanceBuildTime = 0; // ms per instance in the last chunk.
+  std::chrono::steady_clock::time_point ConstructionStartTime;
+  vtkSmartPointer<vtkFloatArray> Centers[NumLayers];
+  // Memory the blocks of a loaded scene cache point into, and the last
+  // written one.
+  std::unique_ptr<SceneCache::Buffer> SceneCacheBuffer;
+  std::vector<char> SceneCacheData;
+
+  // One mesh per layer and level of detail, centered at the origin.
+  vtkSmartPointer<vtkPolyData> Primitives[NumLayers][NumLevelsOfDetail];
+  // Primitives and buffer bytes of the composite meshes, one per layer and
+  // level for generated scenes, one per block for loaded ones.
+  std::vector<MeshSize> MeshSizes;
+  int MeshSizesRepresentation = -1;
+  // Level of detail of every block, indexed by block id.
+  std::vector<unsigned char> BlockLevels;
+  std::vector<unsigned char> NextBlockLevels;
+  bool LevelOfDetail = true;
+  // Adaptive quality while the camera moves.
+  bool InteractionQuality = true;
+  double InteractionFrameBudget = 1000.0 / 30.0;
+  RenderQuality FrameQuality = RenderQuality::Full;
+  // the next frame is at full quality although the camera moves.
+  bool RefineRequested = false;
+  int RefineTimerId = -1;
+  // Blocks outside of the view frustum, indexed by block id.
+  std::vector<unsigned char> BlockCulled;
+  std::vector<unsigned char> NextBlockCulled;
+  bool FrustumCulling = true;
+  vtkIdType NumberOfCulledBlocks = 0;
+  double CullingTime = 0;
+  // Position and color of every instance. (Instanced strategy)
+  vtkNew<vtkPolyData> Instances[NumLayers];
+  vtkNew<vtkActor> InstancedActors[NumLayers];
+  // One mesh with the blocks of every layer. (Merged strategy)
+  // The points of all blocks are kept, only the visible blocks have cells.
+  // Cells of the n-th drawn block start at MergedCellOffsets[layer][n], its
+  // instance is MergedInstances[layer][n] and its block id follows the
+  // instanced numbering. The cells also carry their instance in an array.
+  vtkNew<vtkPolyData> MergedMeshes[NumLayers];
+  vtkNew<vtkActor> MergedActors[NumLayers];
+  vtkNew<vtkIdTypeArray> MergedCellInstanceIds[NumLayers];
+  std::vector<vtkIdType> MergedInstances[NumLayers];
+  std::vector<vtkIdType> MergedCellOffsets[NumLayers];
+
+  // Visibility and color of every block, indexed by block id.
+  BlockAttributes Attributes;
+  // Dataset figures are updated when the datasets change, heap figures
+  // after every render.
+  MemoryStats Memory;
+  FrameTimer Timer;
+  // Pick time already charged to earlier frames.
+  double ChargedHoverPickTime = 0;
+  double PendingAreaPickTime = 0;
+  // Latest modification time of what the mappers upload to the GPU.
+  vtkMTimeType RenderedMTime = 0;
+  bool MappersRebuilt = false;
+  // Bounds of every block, indexed by block id.
+  std::vector<BlockBVH::Bounds> BlockBounds;
+  BlockBVH BVH;
+  AreaPicker AreaPickerType = AreaPicker::HardwareSelector;
+  double AreaPickTime = 0;
+  CellSelection SelectedCells;
+  vtkNew<vtkPolyData> AreaSelectionMesh;
 
   vtkNew<vtkCompositeDataDisplayAttributes> DisplayAttributes;
   vtkNew<vtkRenderWindowInteractor> Interactor;
@@ -80,28 +561,208 @@ EMSCRIPTEN_BINDINGS(benchmark_app_binding) {
   emscripten::class_<BenchmarkApp>("BenchmarkApp")
       .constructor<>()
       .function("initialize", &BenchmarkApp::Initialize)
+      .function("isMultithreaded", &BenchmarkApp::IsMultithreaded)
+      .function("getSMPBackend", &BenchmarkApp::GetSMPBackend)
+      .function("getNumberOfThreads", &BenchmarkApp::GetNumberOfThreads)
       .function("run", &BenchmarkApp::Run)
       .function("clearSelections", &BenchmarkApp::ClearSelections)
       .function("createDatasets", &BenchmarkApp::CreateDatasets)
+      .function("loadScene", &BenchmarkApp::LoadScene)
+      .function("loadSceneFile", &BenchmarkApp::LoadSceneFile)
+      .function("getSceneDescription", &BenchmarkApp::GetSceneDescription)
+      .function("setConstructionBudget", &BenchmarkApp::SetConstructionBudget)
+      .function("getConstructionProgress",
+                &BenchmarkApp::GetConstructionProgress)
+      .function("isConstructionPending", &BenchmarkApp::IsConstructionPending)
+      .function("getConstructionFrameTime",
+                &BenchmarkApp::GetConstructionFrameTime)
+      .function("getDatasetsGenerationTime",
+                &BenchmarkApp::GetDatasetsGenerationTime)
       .function("setEdgeColor", &BenchmarkApp::SetEdgeColor)
       .function("setLayerVisibility", &BenchmarkApp::SetLayerVisibility)
+      .function("setBlocksVisibility", &BenchmarkApp::SetBlocksVisibility)
+      .function("setBlocksVisibilityFromBitset",
+                &BenchmarkApp::SetBlocksVisibilityFromBitset)
+      .function("setBlocksColor", &BenchmarkApp::SetBlocksColor)
+      .function("setBlocksColorFromBitset",
+                &BenchmarkApp::SetBlocksColorFromBitset)
+      .function("removeBlocksColor", &BenchmarkApp::RemoveBlocksColor)
+      .function("getNumberOfBlocks", &BenchmarkApp::GetNumberOfBlocks)
       .function("setLineWidth", &BenchmarkApp::SetLineWidth)
       .function("setPickType", &BenchmarkApp::SetPickType)
+      .function("setAreaPicker", &BenchmarkApp::SetAreaPicker)
+      .function("getAreaPickTime", &BenchmarkApp::GetAreaPickTime)
+      .function("getNumberOfSelectedCells",
+                &BenchmarkApp::GetNumberOfSelectedCells)
+      // the cells of the i-th selected block are getSelectedCellIds() from
+      // getSelectedCellOffsets()[i] to getSelectedCellOffsets()[i + 1], of
+      // its mesh at level getSelectedBlockLevels()[i].
+      // copied into new arrays, like getFrameTimings.
+      .function("getSelectedBlockIds",
+                emscripten::optional_override([](BenchmarkApp &self) {
+                  const auto &ids = self.GetSelectedCells().GetBlockIds();
+                  return emscripten::val::global("Uint32Array")
+                      .new_(emscripten::typed_memory_view(ids.size(),
+                                                          ids.data()));
+                }))
+      .function("getSelectedBlockLevels",
+                emscripten::optional_override([](BenchmarkApp &self) {
+                  const auto &levels = self.GetSelectedCells().GetLevels();
+                  return emscripten::val::global("Uint32Array")
+                      .new_(emscripten::typed_memory_view(levels.size(),
+                                                          levels.data()));
+                }))
+      .function("getSelectedCellOffsets",
+                emscripten::optional_override([](BenchmarkApp &self) {
+                  const auto &offsets = self.GetSelectedCells().GetOffsets();
+                  return emscripten::val::global("Uint32Array")
+                      .new_(emscripten::typed_memory_view(offsets.size(),
+                                                          offsets.data()));
+                }))
+      .function("getSelectedCellIds",
+                emscripten::optional_override([](BenchmarkApp &self) {
+                  const auto &ids = self.GetSelectedCells().GetCellIds();
+                  return emscripten::val::global("Uint32Array")
+                      .new_(emscripten::typed_memory_view(ids.size(),
+                                                          ids.data()));
+                }))
       .function("setScrollSensitivity", &BenchmarkApp::SetScrollSensitivity)
       .function("setPointSize", &BenchmarkApp::SetPointSize)
       .function("setRepresentation", &BenchmarkApp::SetRepresentation)
+      .function("setRenderStrategy", &BenchmarkApp::SetRenderStrategy)
+      // the value of the enum, so that it can be posted from the worker.
+      .function("getRenderStrategy",
+                emscripten::optional_override([](BenchmarkApp &self) {
+                  return static_cast<int>(self.GetRenderStrategy());
+                }))
+      .function("setLevelOfDetail", &BenchmarkApp::SetLevelOfDetail)
+      .function("setFrustumCulling", &BenchmarkApp::SetFrustumCulling)
+      .function("setNumberOfViews", &BenchmarkApp::SetNumberOfViews)
+      .function("getNumberOfViews", &BenchmarkApp::GetNumberOfViews)
+      .function("setInteractionQuality", &BenchmarkApp::SetInteractionQuality)
+      .function("setInteractionFrameBudget",
+                &BenchmarkApp::SetInteractionFrameBudget)
+      .function("getFrameQuality", &BenchmarkApp::GetFrameQuality)
+      .function("getFrameQualities",
+                emscripten::optional_override([](BenchmarkApp &self) {
+                  const auto qualities = self.GetFrameQualities();
+                  return emscripten::val::global("Int32Array")
+                      .new_(emscripten::typed_memory_view(qualities.size(),
+                                                          qualities.data()));
+                }))
+      .function("getNumberOfCulledBlocks",
+                &BenchmarkApp::GetNumberOfCulledBlocks)
+      .function("getCullingTime", &BenchmarkApp::GetCullingTime)
+      .function("getDatasetsMemorySize", &BenchmarkApp::GetDatasetsMemorySize)
+      .function("getMemoryStats", &BenchmarkApp::GetMemoryStats)
+      .function("getStartupTime", &BenchmarkApp::GetStartupTime)
       .function("setSelectedBlockColor", &BenchmarkApp::SetSelectedBlockColor)
+      .function("setLayerOpacity", &BenchmarkApp::SetLayerOpacity)
+      .function("setSelectedBlockOpacity",
+                &BenchmarkApp::SetSelectedBlockOpacity)
+      .function("setTranslucencyTechnique",
+                &BenchmarkApp::SetTranslucencyTechnique)
+      .function("setMaximumNumberOfPeels",
+                &BenchmarkApp::SetMaximumNumberOfPeels)
+      .function("setGPUWaitTiming", &BenchmarkApp::SetGPUWaitTiming)
       .function("resetView", &BenchmarkApp::ResetView)
       .function("render", &BenchmarkApp::Render)
+      .function("requestRender", &BenchmarkApp::RequestRender)
+      .function("getNumberOfRenders", &BenchmarkApp::GetNumberOfRenders)
+      .function("getNumberOfRenderRequests",
+                &BenchmarkApp::GetNumberOfRenderRequests)
+      .function("getNumberOfCoalescedRenders",
+                &BenchmarkApp::GetNumberOfCoalescedRenders)
+      .function("getNumberOfSkippedRenders",
+                &BenchmarkApp::GetNumberOfSkippedRenders)
       .function("getCameraState", &BenchmarkApp::GetCameraState)
       .function("setCameraState", &BenchmarkApp::SetCameraState)
       .function("setShowCameraManipulator", &BenchmarkApp::SetShowCameraManipulator)
       .function("loadFileFromBinary", &BenchmarkApp::LoadFileFromBinary)
-      .function("loadFile", &BenchmarkApp::LoadFile);
+      .function("loadFile", &BenchmarkApp::LoadFile)
+      .function("writeSceneCache", &BenchmarkApp::WriteSceneCache)
+      .function("getSceneCacheData", &BenchmarkApp::GetSceneCacheData)
+      .function("releaseSceneCache", &BenchmarkApp::ReleaseSceneCache)
+      .function("loadSceneCacheFromBinary",
+                &BenchmarkApp::LoadSceneCacheFromBinary)
+      .function("getLoadTime", &BenchmarkApp::GetLoadTime)
+      .function("getLoadedBytes", &BenchmarkApp::GetLoadedBytes)
+      .function("getHoverPickTime", &BenchmarkApp::GetHoverPickTime)
+      .function("getFrameTimings",
+                emscripten::optional_override([](BenchmarkApp &self) {
+                  // copied into a new array, a view on the heap would be
+                  // detached as soon as the heap grows.
+                  const auto samples = self.GetFrameTimings();
+                  return emscripten::val::global("Float64Array")
+                      .new_(emscripten::typed_memory_view(samples.size(),
+                                                          samples.data()));
+                }))
+      .function("getFrameTimingStatistics",
+                &BenchmarkApp::GetFrameTimingStatistics)
+      .function("getViewTimingStatistics",
+                &BenchmarkApp::GetViewTimingStatistics)
+      .function("clearFrameTimings", &BenchmarkApp::ClearFrameTimings)
+      .function("setFrameTimingsCapacity",
+                &BenchmarkApp::SetFrameTimingsCapacity)
+      .function("startRecording", &BenchmarkApp::StartRecording)
+      .function("stopRecording", &BenchmarkApp::StopRecording)
+      .function("isRecording", &BenchmarkApp::IsRecording)
+      .function("startReplay", &BenchmarkApp::StartReplay)
+      .function("stepReplay", &BenchmarkApp::StepReplay)
+      .function("playReplay", &BenchmarkApp::PlayReplay)
+      .function("isReplaying", &BenchmarkApp::IsReplaying)
+      .function("dispatchInput", &BenchmarkApp::DispatchInput);
   emscripten::enum_<BenchmarkApp::LayerID>("LayerID")
       .value("Cone", BenchmarkApp::LayerID::Cone)
       .value("Sphere", BenchmarkApp::LayerID::Sphere)
       .value("Cylinder", BenchmarkApp::LayerID::Cylinder);
+  emscripten::enum_<BenchmarkApp::RenderStrategy>("RenderStrategy")
+      .value("Composite", BenchmarkApp::RenderStrategy::Composite)
+      .value("Instanced", BenchmarkApp::RenderStrategy::Instanced)
+      .value("Merged", BenchmarkApp::RenderStrategy::Merged);
+  emscripten::enum_<BenchmarkApp::AreaPicker>("AreaPicker")
+      .value("HardwareSelector", BenchmarkApp::AreaPicker::HardwareSelector)
+      .value("BoundingVolumeHierarchy",
+             BenchmarkApp::AreaPicker::BoundingVolumeHierarchy);
+  emscripten::enum_<BenchmarkApp::RenderQuality>("RenderQuality")
+      .value("Full", BenchmarkApp::RenderQuality::Full)
+      .value("Reduced", BenchmarkApp::RenderQuality::Reduced)
+      .value("Coarse", BenchmarkApp::RenderQuality::Coarse);
+  emscripten::enum_<BenchmarkApp::TranslucencyTechnique>(
+      "TranslucencyTechnique")
+      .value("DepthPeeling", BenchmarkApp::TranslucencyTechnique::DepthPeeling)
+      .value("OrderIndependent",
+             BenchmarkApp::TranslucencyTechnique::OrderIndependent);
+  emscripten::enum_<BenchmarkApp::StartupPhase>("StartupPhase")
+      .value("Constructed", BenchmarkApp::StartupPhase::Constructed)
+      .value("Initialized", BenchmarkApp::StartupPhase::Initialized)
+      .value("SceneReady", BenchmarkApp::StartupPhase::SceneReady)
+      .value("FirstFrame", BenchmarkApp::StartupPhase::FirstFrame);
+  emscripten::enum_<FrameTimer::Phase>("FramePhase")
+      .value("Update", FrameTimer::Phase::Update)
+      .value("MapperBuild", FrameTimer::Phase::MapperBuild)
+      .value("DrawSubmission", FrameTimer::Phase::DrawSubmission)
+      .value("Translucency", FrameTimer::Phase::Translucency)
+      .value("Pick", FrameTimer::Phase::Pick)
+      .value("GPUWait", FrameTimer::Phase::GPUWait)
+      .value("Total", FrameTimer::Phase::Total);
+  emscripten::value_object<MemoryStats>("MemoryStats")
+      .field("heapSize", &MemoryStats::heapSize)
+      .field("heapUsed", &MemoryStats::heapUsed)
+      .field("heapHighWaterMark", &MemoryStats::heapHighWaterMark)
+      .field("points", &MemoryStats::points)
+      .field("cells", &MemoryStats::cells)
+      .field("colors", &MemoryStats::colors)
+      .field("otherArrays", &MemoryStats::otherArrays)
+      .field("gpuBuffers", &MemoryStats::gpuBuffers);
+  emscripten::value_object<SummaryStatistics>("SummaryStatistics")
+      .field("count", &SummaryStatistics::count)
+      .field("min", &SummaryStatistics::min)
+      .field("max", &SummaryStatistics::max)
+      .field("mean", &SummaryStatistics::mean)
+      .field("p50", &SummaryStatistics::p50)
+      .field("p95", &SummaryStatistics::p95)
+      .field("p99", &SummaryStatistics::p99);
   emscripten::enum_<BenchmarkApp::PickType>("PickType")
       .value("Area", BenchmarkApp::PickType::Area)
       .value("Hover", BenchmarkApp::PickType::Hover)
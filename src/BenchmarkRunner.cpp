@@ -0,0 +1,493 @@
+#include "BenchmarkRunner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+std::vector<std::string> Split(const std::string &arg, char delim) {
+  std::vector<std::string> tokens;
+  std::stringstream ss(arg);
+  std::string token;
+  while (std::getline(ss, token, delim)) {
+    if (!token.empty()) {
+      tokens.emplace_back(token);
+    }
+  }
+  return tokens;
+}
+
+// False when the token is not an integer as a whole.
+bool ParseInt(const std::string &token, int &value) {
+  try {
+    std::size_t length = 0;
+    value = std::stoi(token, &length);
+    return length == token.size();
+  } catch (const std::invalid_argument &) {
+    return false;
+  } catch (const std::out_of_range &) {
+    return false;
+  }
+}
+
+const char *PickTypeName(BenchmarkApp::PickType pickType,
+                         BenchmarkApp::AreaPicker areaPicker =
+                             BenchmarkApp::AreaPicker::HardwareSelector) {
+  switch (pickType) {
+  case BenchmarkApp::PickType::Area:
+    return areaPicker == BenchmarkApp::AreaPicker::BoundingVolumeHierarchy
+               ? "area-bvh"
+               : "area";
+  case BenchmarkApp::PickType::Hover:
+    return "hover";
+  default:
+    return "none";
+  }
+}
+
+const char *StrategyName(BenchmarkApp::RenderStrategy strategy) {
+  if (strategy == BenchmarkApp::RenderStrategy::Merged) {
+    return "merged";
+  }
+  return strategy == BenchmarkApp::RenderStrategy::Instanced ? "instanced"
+                                                             : "composite";
+}
+
+// Quoted JSON string, scene names come from files.
+std::string JsonString(const std::string &value) {
+  std::string quoted = "\"";
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      quoted += escaped;
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + '"';
+}
+
+const char *
+TranslucencyName(BenchmarkApp::TranslucencyTechnique translucency) {
+  return translucency == BenchmarkApp::TranslucencyTechnique::OrderIndependent
+             ? "oit"
+             : "peeling";
+}
+} // namespace
+
+std::vector<std::array<int, 2>>
+BenchmarkRunner::ParseGridSizes(const std::string &arg) {
+  std::vector<std::array<int, 2>> sizes;
+  for (const auto &token : Split(arg, ',')) {
+    const auto dims = Split(token, 'x');
+    std::array<int, 2> size;
+    if (dims.size() == 1 && ::ParseInt(dims[0], size[0])) {
+      sizes.push_back({size[0], size[0]});
+    } else if (dims.size() == 2 && ::ParseInt(dims[0], size[0]) &&
+               ::ParseInt(dims[1], size[1])) {
+      sizes.push_back(size);
+    } else {
+      std::cerr << "Invalid grid size " << token << std::endl;
+    }
+  }
+  return sizes;
+}
+
+std::vector<SceneDescription>
+BenchmarkRunner::ParseSceneFiles(const std::string &arg) {
+  std::vector<SceneDescription> scenes;
+  for (const auto &token : Split(arg, ',')) {
+    SceneDescription scene;
+    std::string error;
+    if (SceneDescription::ReadFile(token, scene, error)) {
+      scenes.emplace_back(std::move(scene));
+    } else {
+      std::cerr << "Invalid scene " << token << ", " << error << std::endl;
+    }
+  }
+  return scenes;
+}
+
+std::vector<int> BenchmarkRunner::ParseRepresentations(const std::string &arg) {
+  std::vector<int> representations;
+  for (const auto &token : Split(arg, ',')) {
+    int representation = 0;
+    if (::ParseInt(token, representation)) {
+      representations.push_back(representation);
+    } else {
+      std::cerr << "Invalid representation " << token << std::endl;
+    }
+  }
+  return representations;
+}
+
+std::vector<int> BenchmarkRunner::ParseViewCounts(const std::string &arg) {
+  std::vector<int> viewCounts;
+  for (const auto &token : Split(arg, ',')) {
+    int views = 0;
+    if (::ParseInt(token, views) && views >= 1 &&
+        views <= FrameTimer::MaxViews) {
+      viewCounts.push_back(views);
+    } else {
+      std::cerr << "Invalid number of views " << token << std::endl;
+    }
+  }
+  return viewCounts;
+}
+
+std::vector<BenchmarkApp::TranslucencyTechnique>
+BenchmarkRunner::ParseTranslucencyTechniques(const std::string &arg) {
+  std::vector<BenchmarkApp::TranslucencyTechnique> techniques;
+  for (const auto &token : Split(arg, ',')) {
+    if (token == "peeling") {
+      techniques.push_back(BenchmarkApp::TranslucencyTechnique::DepthPeeling);
+    } else if (token == "oit") {
+      techniques.push_back(
+          BenchmarkApp::TranslucencyTechnique::OrderIndependent);
+    } else {
+      std::cerr << "Invalid translucency technique " << token << std::endl;
+    }
+  }
+  return techniques;
+}
+
+std::vector<BenchmarkApp::PickType>
+BenchmarkRunner::ParsePickTypes(const std::string &arg) {
+  std::vector<BenchmarkApp::PickType> pickTypes;
+  for (const auto &token : Split(arg, ',')) {
+    if (token == "area") {
+      pickTypes.push_back(BenchmarkApp::PickType::Area);
+    } else if (token == "hover") {
+      pickTypes.push_back(BenchmarkApp::PickType::Hover);
+    } else if (token == "none") {
+      pickTypes.push_back(BenchmarkApp::PickType::None);
+    } else {
+      std::cerr << "Invalid pick type " << token << std::endl;
+    }
+  }
+  return pickTypes;
+}
+
+std::vector<BenchmarkApp::RenderStrategy>
+BenchmarkRunner::ParseRenderStrategies(const std::string &arg) {
+  std::vector<BenchmarkApp::RenderStrategy> strategies;
+  for (const auto &token : Split(arg, ',')) {
+    if (token == "composite") {
+      strategies.push_back(BenchmarkApp::RenderStrategy::Composite);
+    } else if (token == "instanced") {
+      strategies.push_back(BenchmarkApp::RenderStrategy::Instanced);
+    } else if (token == "merged") {
+      strategies.push_back(BenchmarkApp::RenderStrategy::Merged);
+    } else {
+      std::cerr << "Invalid render strategy " << token << std::endl;
+    }
+  }
+  return strategies;
+}
+
+std::vector<BenchmarkApp::AreaPicker>
+BenchmarkRunner::ParseAreaPickers(const std::string &arg) {
+  std::vector<BenchmarkApp::AreaPicker> pickers;
+  for (const auto &token : Split(arg, ',')) {
+    if (token == "hardware") {
+      pickers.push_back(BenchmarkApp::AreaPicker::HardwareSelector);
+    } else if (token == "bvh") {
+      pickers.push_back(BenchmarkApp::AreaPicker::BoundingVolumeHierarchy);
+    } else {
+      std::cerr << "Invalid area picker " << token << std::endl;
+    }
+  }
+  return pickers;
+}
+
+int BenchmarkRunner::Run(BenchmarkApp &app) {
+  app.SetOffScreenRendering(true);
+  app.SetWindowSize(this->Width, this->Height);
+  app.SetLineWidth(this->LineWidth);
+  app.SetPointSize(this->PointSize);
+  app.SetMaximumNumberOfPeels(this->MaximumNumberOfPeels);
+  // the GPU time of every frame is part of the report.
+  app.SetGPUWaitTiming(true);
+  for (int layer = 0; layer < BenchmarkApp::NumLayers; ++layer) {
+    app.SetLayerOpacity(BenchmarkApp::LayerID(layer), this->Opacity);
+  }
+
+  std::vector<SceneDescription> scenes = this->Scenes;
+  if (scenes.empty()) {
+    for (const auto &gridSize : this->GridSizes) {
+      scenes.emplace_back(SceneDescription::MakeGrid(gridSize[0], gridSize[1]));
+    }
+  }
+
+  std::vector<Result> results;
+  for (const auto &strategy : this->RenderStrategies) {
+    app.SetRenderStrategy(strategy);
+    for (const auto &scene : scenes) {
+      // the blocks only depend on the scene and the strategy.
+      app.CreateScene(scene);
+      const bool grid = scene.layout == SceneDescription::Grid;
+      for (const auto &views : this->ViewCounts) {
+        for (const auto &translucency : this->TranslucencyTechniques) {
+          for (const auto &representation : this->Representations) {
+            for (const auto &pickType : this->PickTypes) {
+              Configuration config;
+              config.scene = scene.name;
+              config.nx = grid ? scene.gridSize[0] : 0;
+              config.ny = grid ? scene.gridSize[1] : 0;
+              config.representation = representation;
+              config.pickType = pickType;
+              config.strategy = strategy;
+              config.views = views;
+              config.translucency = translucency;
+              if (pickType != BenchmarkApp::PickType::Area) {
+                results.emplace_back(this->RunConfiguration(app, config));
+                continue;
+              }
+              for (const auto &areaPicker : this->AreaPickers) {
+                config.areaPicker = areaPicker;
+                results.emplace_back(this->RunConfiguration(app, config));
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  app.SetPickType(BenchmarkApp::PickType::None);
+  // the report is still written to look into the failing configurations.
+  const bool valid =
+      std::none_of(results.begin(), results.end(), [](const Result &result) {
+        return result.invalidSteps > 0;
+      });
+  return this->WriteReport(results) && valid ? 0 : 1;
+}
+
+BenchmarkRunner::Result
+BenchmarkRunner::RunConfiguration(BenchmarkApp &app,
+                                  const Configuration &config) {
+  using clock = std::chrono::steady_clock;
+  using ms = std::chrono::duration<double, std::milli>;
+
+  Result result;
+  result.config = config;
+  app.ClearSelections();
+  app.SetRepresentation(config.representation);
+  app.SetPickType(config.pickType);
+  app.SetAreaPicker(config.areaPicker);
+  app.SetNumberOfViews(config.views);
+  app.SetTranslucencyTechnique(config.translucency);
+  app.InitializeView();
+
+  // the first frame uploads all buffers and compiles shaders.
+  auto start = clock::now();
+  app.Render();
+  app.WaitForCompletion();
+  result.firstFrameTime = ms(clock::now() - start).count();
+
+  // picks are issued at the center of the viewport every frame.
+  const int cx = this->Width / 2, cy = this->Height / 2;
+  const double step = 360.0 / std::max(this->NumberOfFrames, 1);
+  std::vector<double> frameTimes, pickTimes, cullingTimes;
+  frameTimes.reserve(this->NumberOfFrames);
+  app.GetHoverPickTime();
+  app.SetFrameTimingsCapacity(this->NumberOfFrames);
+  if (!this->Replay.empty() &&
+      app.StartReplay(this->Replay, this->ReplayTimestep) > 0) {
+    for (bool pending = true; pending;) {
+      start = clock::now();
+      pending = app.StepReplay();
+      app.WaitForCompletion();
+      frameTimes.push_back(ms(clock::now() - start).count());
+      cullingTimes.push_back(app.GetCullingTime());
+    }
+    // the picks come with the recorded events, the frames that had one
+    // report it in their pick phase.
+    const auto samples = app.GetFrameTimings();
+    for (std::size_t i = FrameTimer::Pick; i < samples.size();
+         i += FrameTimer::NumberOfPhases) {
+      if (samples[i] > 0) {
+        pickTimes.push_back(samples[i]);
+      }
+    }
+  }
+  for (int frame = 0; frame < this->NumberOfFrames && this->Replay.empty();
+       ++frame) {
+    start = clock::now();
+    const int renders = app.GetNumberOfRenders();
+    app.OrbitCamera(step);
+    if (config.pickType == BenchmarkApp::PickType::Area) {
+      // renders the scene with the new selection.
+      app.AreaPick(cx - this->Width / 4, cy - this->Height / 4,
+                   cx + this->Width / 4, cy + this->Height / 4);
+      pickTimes.push_back(app.GetAreaPickTime());
+    } else {
+      if (config.pickType == BenchmarkApp::PickType::Hover) {
+        app.HoverPick(cx, cy);
+        pickTimes.push_back(app.GetHoverPickTime());
+      }
+      app.Render();
+    }
+    app.WaitForCompletion();
+    frameTimes.push_back(ms(clock::now() - start).count());
+    cullingTimes.push_back(app.GetCullingTime());
+    // a pick must not draw a frame of its own.
+    if (app.GetNumberOfRenders() - renders != 1) {
+      ++result.invalidSteps;
+    }
+  }
+  result.frameTimes = SummaryStatistics::Compute(std::move(frameTimes));
+  result.pickTimes = SummaryStatistics::Compute(std::move(pickTimes));
+  for (int phase = 0; phase < FrameTimer::NumberOfPhases; ++phase) {
+    result.phaseTimes[phase] =
+        app.GetFrameTimingStatistics(FrameTimer::Phase(phase));
+  }
+  result.primitives = app.GetPrimitiveCounts();
+  result.numObjects = app.GetNumberOfBlocks();
+  result.datasetsMemory = app.GetDatasetsMemorySize();
+  result.memory = app.GetMemoryStats();
+  result.culledBlocks = app.GetNumberOfCulledBlocks();
+  result.cullingTimes = SummaryStatistics::Compute(std::move(cullingTimes));
+  for (const int quality : app.GetFrameQualities()) {
+    ++result.qualityFrames[quality];
+  }
+  for (int view = 0; view < config.views; ++view) {
+    result.viewTimes[view] = app.GetViewTimingStatistics(view);
+  }
+
+  std::cout << "Benchmark " << StrategyName(config.strategy) << ' '
+            << config.scene << ' ' << config.nx << 'x' << config.ny
+            << " views=" << config.views
+            << " translucency=" << TranslucencyName(config.translucency)
+            << " representation=" << config.representation
+            << " pick=" << PickTypeName(config.pickType, config.areaPicker)
+            << " p50=" << result.frameTimes.p50
+            << "ms p95=" << result.frameTimes.p95
+            << "ms p99=" << result.frameTimes.p99 << "ms" << std::endl;
+  if (result.invalidSteps > 0) {
+    std::cerr << "Benchmark rendered more or less than one frame in "
+              << result.invalidSteps << " steps" << std::endl;
+  }
+  return result;
+}
+
+bool BenchmarkRunner::WriteReport(const std::vector<Result> &results) const {
+  std::ofstream out(this->ReportFileName);
+  if (!out) {
+    std::cerr << "Cannot open " << this->ReportFileName << " for writing"
+              << std::endl;
+    return false;
+  }
+  const auto &name = this->ReportFileName;
+  const bool csv =
+      name.size() >= 4 && name.compare(name.size() - 4, 4, ".csv") == 0;
+  if (csv) {
+    out << "strategy,scene,nx,ny,representation,pick,objects,datasets_kib,"
+           "frames,first_frame_ms,min_ms,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,"
+           "pick_p50_ms,pick_p95_ms,triangles,lines,points,heap_peak_kib,"
+           "gpu_buffers_kib,culled,culling_p50_ms,full_frames,reduced_frames,"
+           "coarse_frames,views";
+    for (int view = 0; view < FrameTimer::MaxViews; ++view) {
+      out << ",view" << view << "_p95_ms";
+    }
+    out << ",translucency,opacity,peels";
+    for (int phase = 0; phase < FrameTimer::Total; ++phase) {
+      out << ',' << FrameTimer::GetPhaseName(FrameTimer::Phase(phase))
+          << "_p95_ms";
+    }
+    out << '\n';
+    for (const auto &result : results) {
+      const auto &stats = result.frameTimes;
+      out << StrategyName(result.config.strategy) << ','
+          << result.config.scene << ',' << result.config.nx
+          << ',' << result.config.ny << ',' << result.config.representation
+          << ','
+          << PickTypeName(result.config.pickType, result.config.areaPicker)
+          << ','
+          << result.numObjects << ',' << result.datasetsMemory << ','
+          << stats.count << ',' << result.firstFrameTime << ','
+          << stats.min << ',' << stats.mean << ',' << stats.p50 << ','
+          << stats.p95 << ',' << stats.p99 << ',' << stats.max << ','
+          << result.pickTimes.p50 << ',' << result.pickTimes.p95 << ','
+          << result.primitives.triangles << ',' << result.primitives.lines
+          << ',' << result.primitives.points << ','
+          << result.memory.heapHighWaterMark / 1024 << ','
+          << result.memory.gpuBuffers / 1024 << ',' << result.culledBlocks
+          << ',' << result.cullingTimes.p50;
+      for (const int frames : result.qualityFrames) {
+        out << ',' << frames;
+      }
+      out << ',' << result.config.views;
+      for (const auto &viewTimes : result.viewTimes) {
+        out << ',' << viewTimes.p95;
+      }
+      out << ',' << TranslucencyName(result.config.translucency) << ','
+          << this->Opacity << ',' << this->MaximumNumberOfPeels;
+      for (int phase = 0; phase < FrameTimer::Total; ++phase) {
+        out << ',' << result.phaseTimes[phase].p95;
+      }
+      out << '\n';
+    }
+  } else {
+    out << "{\n  \"width\": " << this->Width << ",\n  \"height\": "
+        << this->Height << ",\n  \"opacity\": " << this->Opacity
+        << ",\n  \"peels\": " << this->MaximumNumberOfPeels
+        << ",\n  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      const auto &result = results[i];
+      const auto &stats = result.frameTimes;
+      out << (i > 0 ? "," : "") << "\n    {"
+          << "\"strategy\": \"" << StrategyName(result.config.strategy)
+          << "\", \"scene\": " << ::JsonString(result.config.scene)
+          << ", \"nx\": " << result.config.nx
+          << ", \"ny\": " << result.config.ny
+          << ", \"representation\": " << result.config.representation
+          << ", \"pick\": \""
+          << PickTypeName(result.config.pickType, result.config.areaPicker)
+          << '"'
+          << ", \"objects\": " << result.numObjects
+          << ", \"datasetsKiB\": " << result.datasetsMemory
+          << ", \"frames\": " << stats.count
+          << ", \"firstFrameMs\": " << result.firstFrameTime
+          << ", \"minMs\": " << stats.min << ", \"meanMs\": " << stats.mean
+          << ", \"p50Ms\": " << stats.p50 << ", \"p95Ms\": " << stats.p95
+          << ", \"p99Ms\": " << stats.p99 << ", \"maxMs\": " << stats.max
+          << ", \"pickP50Ms\": " << result.pickTimes.p50
+          << ", \"pickP95Ms\": " << result.pickTimes.p95
+          << ", \"triangles\": " << result.primitives.triangles
+          << ", \"lines\": " << result.primitives.lines
+          << ", \"points\": " << result.primitives.points
+          << ", \"heapPeakKiB\": " << result.memory.heapHighWaterMark / 1024
+          << ", \"gpuBuffersKiB\": " << result.memory.gpuBuffers / 1024
+          << ", \"culled\": " << result.culledBlocks
+          << ", \"cullingP50Ms\": " << result.cullingTimes.p50
+          << ", \"qualityFrames\": {\"full\": " << result.qualityFrames[0]
+          << ", \"reduced\": " << result.qualityFrames[1]
+          << ", \"coarse\": " << result.qualityFrames[2] << '}'
+          << ", \"views\": " << result.config.views << ", \"viewP95Ms\": [";
+      for (int view = 0; view < result.config.views; ++view) {
+        out << (view > 0 ? ", " : "") << result.viewTimes[view].p95;
+      }
+      out << "], \"translucency\": \""
+          << TranslucencyName(result.config.translucency)
+          << "\", \"phaseP95Ms\": {";
+      for (int phase = 0; phase < FrameTimer::Total; ++phase) {
+        out << (phase > 0 ? ", " : "") << '"'
+            << FrameTimer::GetPhaseName(FrameTimer::Phase(phase))
+            << "\": " << result.phaseTimes[phase].p95;
+      }
+      out << "}}";
+    }
+    out << "\n  ]\n}\n";
+  }
+  std::cout << "Wrote " << results.size() << " results to " << name
+            << std::endl;
+  return true;
+}
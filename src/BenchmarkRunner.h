@@ -0,0 +1,111 @@
+#pragma once
+
+#include "App.h"
+#include "Statistics.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Non-interactive benchmark. Sweeps a matrix of grid sizes, representations
+// and pick modes, plays a fixed camera orbit or a recorded input for each
+// configuration and writes the frame time statistics to a JSON or CSV report.
+class BenchmarkRunner {
+public:
+  struct Configuration {
+    std::string scene = "grid";
+    // grid size, 0 for the random layout.
+    int nx = 32;
+    int ny = 32;
+    int representation = 3;
+    BenchmarkApp::PickType pickType = BenchmarkApp::PickType::None;
+    BenchmarkApp::RenderStrategy strategy =
+        BenchmarkApp::RenderStrategy::Composite;
+    BenchmarkApp::AreaPicker areaPicker =
+        BenchmarkApp::AreaPicker::HardwareSelector;
+    int views = 1;
+    BenchmarkApp::TranslucencyTechnique translucency =
+        BenchmarkApp::TranslucencyTechnique::DepthPeeling;
+  };
+
+  struct Result {
+    Configuration config;
+    int numObjects = 0;
+    double firstFrameTime = 0; // ms, excluded from the statistics.
+    SummaryStatistics frameTimes; // ms
+    SummaryStatistics pickTimes;  // ms
+    // ms, per phase of the frames as recorded by the app.
+    std::array<SummaryStatistics, FrameTimer::NumberOfPhases> phaseTimes;
+    PrimitiveCounts primitives;
+    unsigned long datasetsMemory = 0; // KiB
+    MemoryStats memory;
+    int culledBlocks = 0; // in the last frame.
+    SummaryStatistics cullingTimes; // ms
+    // frames per BenchmarkApp::RenderQuality, replays only drop the quality.
+    std::array<int, 3> qualityFrames = {0, 0, 0};
+    // ms, render time of every view, zeros past the number of views.
+    std::array<SummaryStatistics, FrameTimer::MaxViews> viewTimes;
+    // Steps of the camera orbit that did not render exactly one frame, the
+    // frame times of those are off.
+    int invalidSteps = 0;
+  };
+
+  // Parses "32x32,64x64" into a list of grid sizes.
+  static std::vector<std::array<int, 2>> ParseGridSizes(const std::string &arg);
+  // Reads "a.scene,b.scene" into a list of scenes. Invalid files are skipped.
+  static std::vector<SceneDescription> ParseSceneFiles(const std::string &arg);
+  // Parses "0,1,2,3" into a list of representations.
+  static std::vector<int> ParseRepresentations(const std::string &arg);
+  // Parses "1,2,4" into a list of view counts.
+  static std::vector<int> ParseViewCounts(const std::string &arg);
+  // Parses "peeling,oit" into a list of translucency techniques.
+  static std::vector<BenchmarkApp::TranslucencyTechnique>
+  ParseTranslucencyTechniques(const std::string &arg);
+  // Parses "none,area,hover" into a list of pick types.
+  static std::vector<BenchmarkApp::PickType>
+  ParsePickTypes(const std::string &arg);
+  // Parses "composite,instanced" into a list of render strategies.
+  static std::vector<BenchmarkApp::RenderStrategy>
+  ParseRenderStrategies(const std::string &arg);
+  // Parses "hardware,bvh" into a list of area pickers.
+  static std::vector<BenchmarkApp::AreaPicker>
+  ParseAreaPickers(const std::string &arg);
+
+  std::vector<std::array<int, 2>> GridSizes = {{32, 32}};
+  // Replace the grid sizes when not empty.
+  std::vector<SceneDescription> Scenes;
+  std::vector<int> Representations = {3};
+  // Number of views the window is split into, see
+  // BenchmarkApp::SetNumberOfViews.
+  std::vector<int> ViewCounts = {1};
+  // Only differ when the opacity is below 1.
+  std::vector<BenchmarkApp::TranslucencyTechnique> TranslucencyTechniques = {
+      BenchmarkApp::TranslucencyTechnique::DepthPeeling};
+  std::vector<BenchmarkApp::PickType> PickTypes = {
+      BenchmarkApp::PickType::None};
+  std::vector<BenchmarkApp::RenderStrategy> RenderStrategies = {
+      BenchmarkApp::RenderStrategy::Composite};
+  // Only used with the area pick type.
+  std::vector<BenchmarkApp::AreaPicker> AreaPickers = {
+      BenchmarkApp::AreaPicker::HardwareSelector};
+  int NumberOfFrames = 360;
+  int Width = 600;
+  int Height = 600;
+  int LineWidth = 1;
+  int PointSize = 1;
+  // Opacity of every layer, and peel limit of depth peeling.
+  double Opacity = 1;
+  int MaximumNumberOfPeels = 4;
+  std::string ReportFileName = "benchmark.json";
+  // Input recording replayed instead of the camera orbit when not empty, one
+  // frame per `ReplayTimestep` ms of recorded input. Its pick events replace
+  // the pick type of the configurations. See InputRecording.
+  std::string Replay;
+  double ReplayTimestep = 1000.0 / 60.0;
+
+  int Run(BenchmarkApp &app);
+
+private:
+  Result RunConfiguration(BenchmarkApp &app, const Configuration &config);
+  bool WriteReport(const std::vector<Result> &results) const;
+};
@@ -0,0 +1,189 @@
+#include "BlockAttributes.h"
+
+#include <algorithm>
+
+void BlockAttributes::Reset(vtkIdType numBlocks) {
+  this->Flags.assign(static_cast<std::size_t>(numBlocks), Visible);
+  this->Colors.assign(static_cast<std::size_t>(numBlocks), Color{});
+  this->SceneColors.clear();
+  this->ColoredBlocks.clear();
+  this->DirtyBlocks.clear();
+  this->VisibilityDirty = false;
+}
+
+const std::vector<vtkIdType> &BlockAttributes::GetColoredBlocks() {
+  auto &blocks = this->ColoredBlocks;
+  blocks.erase(std::remove_if(blocks.begin(), blocks.end(),
+                              [this](vtkIdType blockId) {
+                                if (this->HasColor(blockId)) {
+                                  return false;
+                                }
+                                this->Flags[blockId] &= ~Listed;
+                                return true;
+                              }),
+               blocks.end());
+  return blocks;
+}
+
+void BlockAttributes::ClearDirtyBlocks() {
+  for (const auto &blockId : this->DirtyBlocks) {
+    this->Flags[blockId] &= ~Dirty;
+  }
+  this->DirtyBlocks.clear();
+  this->VisibilityDirty = false;
+}
+
+void BlockAttributes::MarkDirty(vtkIdType blockId) {
+  if ((this->Flags[blockId] & Dirty) == 0) {
+    this->Flags[blockId] |= Dirty;
+    this->DirtyBlocks.push_back(blockId);
+  }
+}
+
+bool BlockAttributes::UpdateVisibility(vtkIdType blockId, bool visible) {
+  if (this->GetVisibility(blockId) == visible) {
+    return false;
+  }
+  this->Flags[blockId] ^= Visible;
+  this->VisibilityDirty = true;
+  this->MarkDirty(blockId);
+  return true;
+}
+
+// A null color removes the override.
+bool BlockAttributes::UpdateColor(vtkIdType blockId, const Color *color) {
+  if (color == nullptr) {
+    if (!this->HasColor(blockId)) {
+      return false;
+    }
+    this->Flags[blockId] &= ~Colored;
+  } else {
+    if (this->HasColor(blockId) && this->Colors[blockId] == *color) {
+      return false;
+    }
+    this->Flags[blockId] |= Colored;
+    this->Colors[blockId] = *color;
+    if ((this->Flags[blockId] & Listed) == 0) {
+      this->Flags[blockId] |= Listed;
+      this->ColoredBlocks.push_back(blockId);
+    }
+  }
+  this->MarkDirty(blockId);
+  return true;
+}
+
+template <typename Functor>
+vtkIdType BlockAttributes::ForEachBit(const std::uint32_t *bits,
+                                      vtkIdType numBlocks, Functor &&functor) {
+  vtkIdType numChanged = 0;
+  if (bits == nullptr) {
+    return numChanged;
+  }
+  numBlocks = std::min(numBlocks, this->GetNumberOfBlocks());
+  const vtkIdType numWords = (numBlocks + 31) / 32;
+  for (vtkIdType word = 0; word < numWords; ++word) {
+    // most words are empty when few blocks are selected.
+    for (std::uint32_t mask = bits[word]; mask != 0; mask &= mask - 1) {
+      int bit = 0;
+      while (((mask >> bit) & 1u) == 0) {
+        ++bit;
+      }
+      const vtkIdType blockId = 32 * word + bit;
+      if (blockId < numBlocks && functor(blockId)) {
+        ++numChanged;
+      }
+    }
+  }
+  return numChanged;
+}
+
+vtkIdType BlockAttributes::SetVisibility(vtkIdType begin, vtkIdType end,
+                                         bool visible) {
+  begin = std::max<vtkIdType>(begin, 0);
+  end = std::min(end, this->GetNumberOfBlocks());
+  vtkIdType numChanged = 0;
+  for (vtkIdType blockId = begin; blockId < end; ++blockId) {
+    numChanged += this->UpdateVisibility(blockId, visible);
+  }
+  return numChanged;
+}
+
+vtkIdType BlockAttributes::SetVisibility(const std::uint32_t *bits,
+                                         vtkIdType numBlocks, bool visible) {
+  return this->ForEachBit(bits, numBlocks, [&](vtkIdType blockId) {
+    return this->UpdateVisibility(blockId, visible);
+  });
+}
+
+vtkIdType BlockAttributes::SetVisibility(const vtkIdType *blockIds,
+                                         vtkIdType numIds, bool visible) {
+  vtkIdType numChanged = 0;
+  for (vtkIdType i = 0; i < numIds; ++i) {
+    const vtkIdType blockId = blockIds[i];
+    if (blockId >= 0 && blockId < this->GetNumberOfBlocks()) {
+      numChanged += this->UpdateVisibility(blockId, visible);
+    }
+  }
+  return numChanged;
+}
+
+vtkIdType BlockAttributes::SetColor(vtkIdType begin, vtkIdType end,
+                                    const Color &color) {
+  begin = std::max<vtkIdType>(begin, 0);
+  end = std::min(end, this->GetNumberOfBlocks());
+  vtkIdType numChanged = 0;
+  for (vtkIdType blockId = begin; blockId < end; ++blockId) {
+    numChanged += this->UpdateColor(blockId, &color);
+  }
+  return numChanged;
+}
+
+vtkIdType BlockAttributes::SetColor(const std::uint32_t *bits,
+                                    vtkIdType numBlocks, const Color &color) {
+  return this->ForEachBit(bits, numBlocks, [&](vtkIdType blockId) {
+    return this->UpdateColor(blockId, &color);
+  });
+}
+
+vtkIdType BlockAttributes::SetColor(const vtkIdType *blockIds,
+                                    vtkIdType numIds, const Color &color) {
+  vtkIdType numChanged = 0;
+  for (vtkIdType i = 0; i < numIds; ++i) {
+    const vtkIdType blockId = blockIds[i];
+    if (blockId >= 0 && blockId < this->GetNumberOfBlocks()) {
+      numChanged += this->UpdateColor(blockId, &color);
+    }
+  }
+  return numChanged;
+}
+
+vtkIdType BlockAttributes::RemoveColor(vtkIdType begin, vtkIdType end) {
+  begin = std::max<vtkIdType>(begin, 0);
+  end = std::min(end, this->GetNumberOfBlocks());
+  vtkIdType numChanged = 0;
+  for (vtkIdType blockId = begin; blockId < end; ++blockId) {
+    numChanged += this->UpdateColor(blockId, nullptr);
+  }
+  return numChanged;
+}
+
+vtkIdType BlockAttributes::SetSceneColor(vtkIdType begin, vtkIdType end,
+                                         const Color &color) {
+  begin = std::max<vtkIdType>(begin, 0);
+  end = std::min(end, this->GetNumberOfBlocks());
+  if (begin < end && this->SceneColors.empty()) {
+    this->SceneColors.resize(this->Flags.size());
+  }
+  vtkIdType numChanged = 0;
+  for (vtkIdType blockId = begin; blockId < end; ++blockId) {
+    if ((this->Flags[blockId] & SceneColored) != 0 &&
+        this->SceneColors[blockId] == color) {
+      continue;
+    }
+    this->Flags[blockId] |= SceneColored;
+    this->SceneColors[blockId] = color;
+    this->MarkDirty(blockId);
+    ++numChanged;
+  }
+  return numChanged;
+}
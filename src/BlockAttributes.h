@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vtkType.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Visibility, scene color and color override of every block in a scene,
+// indexed by block id. Updates are batched over ranges or bitsets of block
+// ids. Only the blocks whose state actually changed are recorded, so that the
+// renderer can be brought up to date without visiting every block.
+class BlockAttributes {
+public:
+  using Color = std::array<double, 3>;
+
+  // Every block becomes visible, without a scene color or color override and
+  // clean.
+  void Reset(vtkIdType numBlocks);
+  vtkIdType GetNumberOfBlocks() const {
+    return static_cast<vtkIdType>(this->Flags.size());
+  }
+
+  // Ranges are [begin, end) and clamped to the number of blocks. Bitsets hold
+  // one bit per block, block `i` is bit `i % 32` of word `i / 32`. Every call
+  // returns the number of blocks that changed.
+  vtkIdType SetVisibility(vtkIdType begin, vtkIdType end, bool visible);
+  vtkIdType SetVisibility(const std::uint32_t *bits, vtkIdType numBlocks,
+                          bool visible);
+  vtkIdType SetVisibility(const vtkIdType *blockIds, vtkIdType numIds,
+                          bool visible);
+  vtkIdType SetColor(vtkIdType begin, vtkIdType end, const Color &color);
+  vtkIdType SetColor(const std::uint32_t *bits, vtkIdType numBlocks,
+                     const Color &color);
+  vtkIdType SetColor(const vtkIdType *blockIds, vtkIdType numIds,
+                     const Color &color);
+  vtkIdType RemoveColor(vtkIdType begin, vtkIdType end);
+  vtkIdType RemoveColors() {
+    return this->RemoveColor(0, this->GetNumberOfBlocks());
+  }
+  // Scene colors replace the layer color of a block. Overrides are drawn on
+  // top of them and removing an override brings them back.
+  vtkIdType SetSceneColor(vtkIdType begin, vtkIdType end, const Color &color);
+
+  bool GetVisibility(vtkIdType blockId) const {
+    return (this->Flags[blockId] & Visible) != 0;
+  }
+  bool HasColor(vtkIdType blockId) const {
+    return (this->Flags[blockId] & Colored) != 0;
+  }
+  const Color &GetColor(vtkIdType blockId) const {
+    return this->Colors[blockId];
+  }
+  // The override, else the scene color, else nullptr for the layer color.
+  const Color *GetDrawnColor(vtkIdType blockId) const {
+    if (this->HasColor(blockId)) {
+      return &this->Colors[blockId];
+    }
+    if ((this->Flags[blockId] & SceneColored) != 0) {
+      return &this->SceneColors[blockId];
+    }
+    return nullptr;
+  }
+
+  // Blocks with a color override, each listed once, in no particular order.
+  // Stale entries of removed overrides are dropped here, so the cost follows
+  // the number of overrides rather than the number of blocks.
+  const std::vector<vtkIdType> &GetColoredBlocks();
+
+  // Blocks changed since the last call to ClearDirtyBlocks, each listed once.
+  const std::vector<vtkIdType> &GetDirtyBlocks() const {
+    return this->DirtyBlocks;
+  }
+  // Marks a block dirty without changing it, when state kept elsewhere, like
+  // its opacity, changed.
+  void Invalidate(vtkIdType blockId) { this->MarkDirty(blockId); }
+  // True when the visibility of a dirty block changed.
+  bool IsVisibilityDirty() const { return this->VisibilityDirty; }
+  void ClearDirtyBlocks();
+
+private:
+  enum Flag : unsigned char {
+    Visible = 1,
+    Colored = 2,
+    Dirty = 4,
+    SceneColored = 8,
+    // In ColoredBlocks, the override may have been removed since.
+    Listed = 16
+  };
+
+  template <typename Functor>
+  vtkIdType ForEachBit(const std::uint32_t *bits, vtkIdType numBlocks,
+                       Functor &&functor);
+  bool UpdateVisibility(vtkIdType blockId, bool visible);
+  bool UpdateColor(vtkIdType blockId, const Color *color);
+  void MarkDirty(vtkIdType blockId);
+
+  std::vector<unsigned char> Flags;
+  std::vector<Color> Colors;
+  // allocated by the first scene color.
+  std::vector<Color> SceneColors;
+  std::vector<vtkIdType> ColoredBlocks;
+  std::vector<vtkIdType> DirtyBlocks;
+  bool VisibilityDirty = false;
+};
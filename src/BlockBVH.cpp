@@ -0,0 +1,179 @@
+#include "BlockBVH.h"
+
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+// Blocks per leaf.
+constexpr vtkIdType LeafSize = 8;
+// Subtrees handed out to the SMP backend.
+constexpr std::size_t MinParallelSubtrees = 64;
+} // namespace
+
+void BlockBVH::Clear() {
+  this->Nodes.clear();
+  this->Ids.clear();
+  this->BlockBounds.clear();
+}
+
+void BlockBVH::Build(const std::vector<Bounds> &bounds) {
+  this->Clear();
+  if (bounds.empty()) {
+    return;
+  }
+  this->BlockBounds = bounds;
+  this->Ids.resize(bounds.size());
+  std::vector<std::array<double, 3>> centers(bounds.size());
+  for (std::size_t i = 0; i < bounds.size(); ++i) {
+    this->Ids[i] = static_cast<vtkIdType>(i);
+    for (int axis = 0; axis < 3; ++axis) {
+      centers[i][axis] = 0.5 * (bounds[i][2 * axis] + bounds[i][2 * axis + 1]);
+    }
+  }
+  this->Nodes.reserve(2 * bounds.size() / LeafSize + 1);
+  this->BuildNode(bounds, centers, 0, static_cast<vtkIdType>(bounds.size()));
+}
+
+int BlockBVH::BuildNode(const std::vector<Bounds> &bounds,
+                        const std::vector<std::array<double, 3>> &centers,
+                        vtkIdType begin, vtkIdType end) {
+  const int nodeId = static_cast<int>(this->Nodes.size());
+  this->Nodes.emplace_back();
+  Bounds box = {std::numeric_limits<double>::max(),
+                std::numeric_limits<double>::lowest(),
+                std::numeric_limits<double>::max(),
+                std::numeric_limits<double>::lowest(),
+                std::numeric_limits<double>::max(),
+                std::numeric_limits<double>::lowest()};
+  for (vtkIdType i = begin; i < end; ++i) {
+    const auto &blockBox = bounds[this->Ids[i]];
+    for (int axis = 0; axis < 3; ++axis) {
+      box[2 * axis] = std::min(box[2 * axis], blockBox[2 * axis]);
+      box[2 * axis + 1] = std::max(box[2 * axis + 1], blockBox[2 * axis + 1]);
+    }
+  }
+  this->Nodes[nodeId].Box = box;
+  this->Nodes[nodeId].Begin = begin;
+  this->Nodes[nodeId].End = end;
+  if (end - begin <= LeafSize) {
+    return nodeId;
+  }
+
+  // median split along the longest axis.
+  int axis = 0;
+  for (int i = 1; i < 3; ++i) {
+    if (box[2 * i + 1] - box[2 * i] > box[2 * axis + 1] - box[2 * axis]) {
+      axis = i;
+    }
+  }
+  const vtkIdType mid = begin + (end - begin) / 2;
+  std::nth_element(this->Ids.begin() + begin, this->Ids.begin() + mid,
+                   this->Ids.begin() + end, [&](vtkIdType a, vtkIdType b) {
+                     return centers[a][axis] < centers[b][axis];
+                   });
+  const int left = this->BuildNode(bounds, centers, begin, mid);
+  const int right = this->BuildNode(bounds, centers, mid, end);
+  this->Nodes[nodeId].Left = left;
+  this->Nodes[nodeId].Right = right;
+  return nodeId;
+}
+
+BlockBVH::Overlap BlockBVH::Classify(const Bounds &box,
+                                     const Frustum &frustum) {
+  Overlap overlap = Inside;
+  for (const auto &plane : frustum) {
+    // corners of the box furthest along and against the plane normal.
+    double maxDist = plane[3], minDist = plane[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      const double lo = plane[axis] * box[2 * axis];
+      const double hi = plane[axis] * box[2 * axis + 1];
+      maxDist += std::max(lo, hi);
+      minDist += std::min(lo, hi);
+    }
+    if (maxDist < 0) {
+      return Outside;
+    }
+    if (minDist < 0) {
+      overlap = Partial;
+    }
+  }
+  return overlap;
+}
+
+void BlockBVH::Collect(int nodeId, const Frustum &frustum,
+                       std::vector<vtkIdType> &result) const {
+  const auto &node = this->Nodes[nodeId];
+  const Overlap overlap = Classify(node.Box, frustum);
+  if (overlap == Outside) {
+    return;
+  }
+  if (overlap == Inside) {
+    result.insert(result.end(), this->Ids.begin() + node.Begin,
+                  this->Ids.begin() + node.End);
+    return;
+  }
+  if (node.Left < 0) {
+    for (vtkIdType i = node.Begin; i < node.End; ++i) {
+      const vtkIdType id = this->Ids[i];
+      if (Classify(this->BlockBounds[id], frustum) != Outside) {
+        result.push_back(id);
+      }
+    }
+    return;
+  }
+  this->Collect(node.Left, frustum, result);
+  this->Collect(node.Right, frustum, result);
+}
+
+std::vector<vtkIdType> BlockBVH::Intersect(const Frustum &frustum) const {
+  std::vector<vtkIdType> result;
+  if (this->Nodes.empty()) {
+    return result;
+  }
+  // walk down breadth first until there are enough subtrees to keep all
+  // threads busy. culled subtrees never make it into the frontier.
+  std::vector<int> frontier = {0};
+  while (frontier.size() < MinParallelSubtrees) {
+    std::vector<int> next;
+    bool expanded = false;
+    for (const int nodeId : frontier) {
+      const auto &node = this->Nodes[nodeId];
+      if (node.Left < 0) {
+        next.push_back(nodeId);
+        continue;
+      }
+      const Overlap overlap = Classify(node.Box, frustum);
+      if (overlap == Outside) {
+        continue;
+      }
+      if (overlap == Inside) {
+        result.insert(result.end(), this->Ids.begin() + node.Begin,
+                      this->Ids.begin() + node.End);
+        continue;
+      }
+      next.push_back(node.Left);
+      next.push_back(node.Right);
+      expanded = true;
+    }
+    frontier.swap(next);
+    if (!expanded) {
+      break;
+    }
+  }
+
+  vtkSMPThreadLocal<std::vector<vtkIdType>> hits;
+  vtkSMPTools::For(0, static_cast<vtkIdType>(frontier.size()),
+                   [&](vtkIdType begin, vtkIdType end) {
+                     auto &local = hits.Local();
+                     for (vtkIdType i = begin; i < end; ++i) {
+                       this->Collect(frontier[i], frustum, local);
+                     }
+                   });
+  for (const auto &local : hits) {
+    result.insert(result.end(), local.begin(), local.end());
+  }
+  return result;
+}
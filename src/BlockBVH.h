@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vtkType.h>
+
+#include <array>
+#include <vector>
+
+// Bounding volume hierarchy over the bounding boxes of the blocks in a scene.
+// Used to resolve rubber-band picks on the CPU: the blocks that intersect a
+// view frustum are found without rendering or reading back any pixels.
+class BlockBVH {
+public:
+  // xmin, xmax, ymin, ymax, zmin, zmax like vtkDataSet::GetBounds.
+  using Bounds = std::array<double, 6>;
+  // a*x + b*y + c*z + d >= 0 for points on the inner side of the plane.
+  using Plane = std::array<double, 4>;
+  using Frustum = std::array<Plane, 6>;
+
+  // Builds the hierarchy. The id of a block is its index in `bounds`.
+  void Build(const std::vector<Bounds> &bounds);
+  void Clear();
+
+  // Ids of the blocks whose bounding box intersects the frustum, in no
+  // particular order. Subtrees are traversed in parallel.
+  std::vector<vtkIdType> Intersect(const Frustum &frustum) const;
+
+  std::size_t GetNumberOfBlocks() const { return this->Ids.size(); }
+  std::size_t GetNumberOfNodes() const { return this->Nodes.size(); }
+
+private:
+  struct Node {
+    Bounds Box;
+    // children, -1 for leaves.
+    int Left = -1;
+    int Right = -1;
+    // range in Ids covered by this node.
+    vtkIdType Begin = 0;
+    vtkIdType End = 0;
+  };
+
+  enum Overlap { Outside, Partial, Inside };
+  static Overlap Classify(const Bounds &box, const Frustum &frustum);
+
+  int BuildNode(const std::vector<Bounds> &bounds,
+                const std::vector<std::array<double, 3>> &centers,
+                vtkIdType begin, vtkIdType end);
+  void Collect(int nodeId, const Frustum &frustum,
+               std::vector<vtkIdType> &result) const;
+
+  std::vector<Node> Nodes;
+  std::vector<vtkIdType> Ids;
+  std::vector<Bounds> BlockBounds;
+};
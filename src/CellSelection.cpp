@@ -0,0 +1,79 @@
+#include "CellSelection.h"
+
+#include <algorithm>
+#include <numeric>
+
+void CellSelection::Clear() {
+  this->BlockIds.clear();
+  this->Levels.clear();
+  this->Offsets.assign(1, 0);
+  this->CellIds.clear();
+  this->Runs.clear();
+  this->PendingCellIds.clear();
+}
+
+void CellSelection::StartBlock(vtkIdType blockId, int level) {
+  // cells of the same block in a row make one run.
+  if (!this->Runs.empty() && this->Runs.back().BlockId == blockId) {
+    return;
+  }
+  this->Runs.push_back({blockId, level, this->PendingCellIds.size()});
+}
+
+void CellSelection::AddCellRange(vtkIdType numCells) {
+  const std::size_t begin = this->PendingCellIds.size();
+  this->PendingCellIds.resize(begin + static_cast<std::size_t>(numCells));
+  std::iota(this->PendingCellIds.begin() + begin, this->PendingCellIds.end(),
+            0u);
+}
+
+void CellSelection::CloseBlock() {
+  const auto first = this->CellIds.begin() + this->Offsets.back();
+  // the selectors mostly report the cells of a block in order already.
+  if (!std::is_sorted(first, this->CellIds.end())) {
+    std::sort(first, this->CellIds.end());
+  }
+  this->CellIds.erase(std::unique(first, this->CellIds.end()),
+                      this->CellIds.end());
+  this->Offsets.push_back(static_cast<std::uint32_t>(this->CellIds.size()));
+}
+
+void CellSelection::Finalize() {
+  // runs of the same block next to each other, in the order they came.
+  std::vector<std::size_t> order(this->Runs.size());
+  std::iota(order.begin(), order.end(), std::size_t(0));
+  std::stable_sort(order.begin(), order.end(),
+                   [this](std::size_t a, std::size_t b) {
+                     return this->Runs[a].BlockId < this->Runs[b].BlockId;
+                   });
+  this->BlockIds.clear();
+  this->Levels.clear();
+  this->Offsets.assign(1, 0);
+  this->CellIds.clear();
+  this->CellIds.reserve(this->PendingCellIds.size());
+  for (const std::size_t i : order) {
+    const auto &run = this->Runs[i];
+    const std::size_t end = i + 1 < this->Runs.size()
+                                ? this->Runs[i + 1].Begin
+                                : this->PendingCellIds.size();
+    if (run.Begin == end) {
+      continue;
+    }
+    const auto blockId = static_cast<std::uint32_t>(run.BlockId);
+    if (this->BlockIds.empty() || this->BlockIds.back() != blockId) {
+      if (!this->BlockIds.empty()) {
+        this->CloseBlock();
+      }
+      this->BlockIds.push_back(blockId);
+      this->Levels.push_back(static_cast<std::uint32_t>(run.Level));
+    }
+    this->CellIds.insert(this->CellIds.end(),
+                         this->PendingCellIds.begin() + run.Begin,
+                         this->PendingCellIds.begin() + end);
+  }
+  if (!this->BlockIds.empty()) {
+    this->CloseBlock();
+  }
+  this->Runs.clear();
+  this->PendingCellIds.clear();
+}
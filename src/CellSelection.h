@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vtkType.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Cells picked in every block, in compressed rows: the cells of the i-th
+// selected block are CellIds[Offsets[i]] up to CellIds[Offsets[i + 1]], ids
+// of the cells of the mesh the block was drawn with, at level of detail
+// Levels[i]. Blocks are sorted by id, cells by id within their block, each
+// listed once. The arrays are 32 bit so that they can be copied to JS typed
+// arrays as they are.
+class CellSelection {
+public:
+  // Starts over with an empty selection.
+  void Clear();
+
+  // Cells are added block by block. A block may start more than once and in
+  // any order, its cells are merged by Finalize. The cells are those of the
+  // given level of detail, the first one a block starts with is kept.
+  void StartBlock(vtkIdType blockId, int level);
+  void AddCell(vtkIdType cellId) {
+    this->PendingCellIds.push_back(static_cast<std::uint32_t>(cellId));
+  }
+  void AddCells(const std::uint32_t *cellIds, std::size_t numCells) {
+    this->PendingCellIds.insert(this->PendingCellIds.end(), cellIds,
+                                cellIds + numCells);
+  }
+  // Adds the cells 0 to numCells - 1 of the current block.
+  void AddCellRange(vtkIdType numCells);
+  // Builds the rows from the added cells.
+  void Finalize();
+
+  std::size_t GetNumberOfBlocks() const { return this->BlockIds.size(); }
+  std::size_t GetNumberOfCells() const { return this->CellIds.size(); }
+  const std::vector<std::uint32_t> &GetBlockIds() const {
+    return this->BlockIds;
+  }
+  // Level of detail of every selected block.
+  const std::vector<std::uint32_t> &GetLevels() const { return this->Levels; }
+  // GetNumberOfBlocks() + 1 values, starting at 0.
+  const std::vector<std::uint32_t> &GetOffsets() const {
+    return this->Offsets;
+  }
+  const std::vector<std::uint32_t> &GetCellIds() const {
+    return this->CellIds;
+  }
+
+private:
+  // Sorts the cells of the last block and drops the repeated ones.
+  void CloseBlock();
+
+  std::vector<std::uint32_t> BlockIds;
+  std::vector<std::uint32_t> Levels;
+  std::vector<std::uint32_t> Offsets = {0};
+  std::vector<std::uint32_t> CellIds;
+
+  // Runs of added cells, each of one block, in the order they were added.
+  struct Run {
+    vtkIdType BlockId;
+    int Level;
+    std::size_t Begin;
+  };
+  std::vector<Run> Runs;
+  std::vector<std::uint32_t> PendingCellIds;
+};
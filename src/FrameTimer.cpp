@@ -0,0 +1,136 @@
+#include "FrameTimer.h"
+
+#include <algorithm>
+#include <utility>
+
+FrameTimer::FrameTimer(std::size_t capacity)
+    : Frames(std::max<std::size_t>(capacity, 1)),
+      Qualities(this->Frames.size()), ViewTimes(this->Frames.size()) {}
+
+void FrameTimer::StartFrame() {
+  this->Current.fill(0);
+  this->CurrentViews.fill(0);
+  this->FrameStarted = true;
+  this->LapTime = std::chrono::steady_clock::now();
+}
+
+void FrameTimer::Lap(Phase phase) {
+  const auto now = std::chrono::steady_clock::now();
+  this->Current[phase] +=
+      std::chrono::duration<double, std::milli>(now - this->LapTime).count();
+  this->LapTime = now;
+}
+
+void FrameTimer::Add(Phase phase, double milliseconds) {
+  this->Current[phase] += milliseconds;
+}
+
+void FrameTimer::AddViewTime(int view, double milliseconds) {
+  if (view >= 0 && view < MaxViews) {
+    this->CurrentViews[view] += milliseconds;
+  }
+}
+
+void FrameTimer::EndFrame() {
+  if (!this->FrameStarted) {
+    return;
+  }
+  double total = 0;
+  for (int phase = 0; phase < Total; ++phase) {
+    total += this->Current[phase];
+  }
+  this->Current[Total] = total;
+  this->Frames[this->Next] = this->Current;
+  this->Qualities[this->Next] = this->CurrentQuality;
+  this->ViewTimes[this->Next] = this->CurrentViews;
+  this->Next = (this->Next + 1) % this->Frames.size();
+  this->Count = std::min(this->Count + 1, this->Frames.size());
+  this->FrameStarted = false;
+}
+
+void FrameTimer::Clear() {
+  this->Next = 0;
+  this->Count = 0;
+  this->FrameStarted = false;
+}
+
+void FrameTimer::SetCapacity(std::size_t capacity) {
+  this->Frames.assign(std::max<std::size_t>(capacity, 1), Frame{});
+  this->Qualities.assign(this->Frames.size(), 0);
+  this->ViewTimes.assign(this->Frames.size(), ViewFrame{});
+  this->Clear();
+}
+
+std::vector<double> FrameTimer::GetSamples() const {
+  std::vector<double> samples;
+  samples.reserve(this->Count * NumberOfPhases);
+  // the oldest frame is at Next once the buffer wrapped around.
+  const std::size_t first =
+      (this->Next + this->Frames.size() - this->Count) % this->Frames.size();
+  for (std::size_t i = 0; i < this->Count; ++i) {
+    const auto &frame = this->Frames[(first + i) % this->Frames.size()];
+    samples.insert(samples.end(), frame.begin(), frame.end());
+  }
+  return samples;
+}
+
+SummaryStatistics FrameTimer::GetStatistics(Phase phase) const {
+  std::vector<double> samples;
+  samples.reserve(this->Count);
+  for (std::size_t i = 0; i < this->Count; ++i) {
+    samples.push_back(this->Frames[i][phase]);
+  }
+  return SummaryStatistics::Compute(std::move(samples));
+}
+
+SummaryStatistics FrameTimer::GetViewStatistics(int view) const {
+  if (view < 0 || view >= MaxViews) {
+    return {};
+  }
+  std::vector<double> samples;
+  samples.reserve(this->Count);
+  for (std::size_t i = 0; i < this->Count; ++i) {
+    samples.push_back(this->ViewTimes[i][view]);
+  }
+  return SummaryStatistics::Compute(std::move(samples));
+}
+
+std::vector<int> FrameTimer::GetQualities() const {
+  std::vector<int> qualities;
+  qualities.reserve(this->Count);
+  const std::size_t first =
+      (this->Next + this->Frames.size() - this->Count) % this->Frames.size();
+  for (std::size_t i = 0; i < this->Count; ++i) {
+    qualities.push_back(this->Qualities[(first + i) % this->Frames.size()]);
+  }
+  return qualities;
+}
+
+FrameTimer::Frame FrameTimer::GetLastFrame() const {
+  if (this->Count == 0) {
+    return Frame{};
+  }
+  return this->Frames[(this->Next + this->Frames.size() - 1) %
+                      this->Frames.size()];
+}
+
+const char *FrameTimer::GetPhaseName(Phase phase) {
+  switch (phase) {
+  case Update:
+    return "update";
+  case MapperBuild:
+    return "mapper_build";
+  case DrawSubmission:
+    return "draw";
+  case Translucency:
+    return "translucency";
+  case Pick:
+    return "pick";
+  case GPUWait:
+    return "gpu_wait";
+  case Total:
+    return "total";
+  default:
+    return "unknown";
+  }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Statistics.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// Fixed size ring buffer with the time spent in every phase of the last
+// frames. Old frames are overwritten once the buffer is full.
+class FrameTimer {
+public:
+  // Total is the sum of the other phases.
+  enum Phase {
+    Update = 0,
+    MapperBuild,
+    DrawSubmission,
+    Translucency,
+    Pick,
+    GPUWait,
+    Total,
+    NumberOfPhases
+  };
+  using Frame = std::array<double, NumberOfPhases>;
+  // Render time of every view of a split window.
+  static constexpr int MaxViews = 4;
+  using ViewFrame = std::array<double, MaxViews>;
+
+  explicit FrameTimer(std::size_t capacity = 1024);
+
+  // Clears the phases of the current frame and starts the clock.
+  void StartFrame();
+  // Charges the time since the last lap (or the frame start) to `phase`.
+  void Lap(Phase phase);
+  // Charges time measured elsewhere to `phase`, in milliseconds.
+  void Add(Phase phase, double milliseconds);
+  // Quality level the current frame is rendered at, kept with its phases.
+  void SetQuality(int quality) { this->CurrentQuality = quality; }
+  // Charges time spent rendering `view` in the current frame, in ms.
+  void AddViewTime(int view, double milliseconds);
+  // Stores the current frame in the ring buffer.
+  void EndFrame();
+  bool IsFrameStarted() const { return this->FrameStarted; }
+
+  void Clear();
+  void SetCapacity(std::size_t capacity);
+  std::size_t GetCapacity() const { return this->Frames.size(); }
+  std::size_t GetNumberOfFrames() const { return this->Count; }
+
+  // Phase times in milliseconds, oldest frame first, NumberOfPhases values
+  // per frame.
+  std::vector<double> GetSamples() const;
+  SummaryStatistics GetStatistics(Phase phase) const;
+  // Quality level of the frames, oldest first.
+  std::vector<int> GetQualities() const;
+  // Phases of the last stored frame, zeros when there is none.
+  Frame GetLastFrame() const;
+  // Render time of `view` over the frames, frames without it count as 0.
+  SummaryStatistics GetViewStatistics(int view) const;
+
+  static const char *GetPhaseName(Phase phase);
+
+private:
+  std::vector<Frame> Frames;
+  std::vector<int> Qualities;
+  std::vector<ViewFrame> ViewTimes;
+  // Slot of the next frame and number of valid frames.
+  std::size_t Next = 0;
+  std::size_t Count = 0;
+
+  Frame Current = {};
+  int CurrentQuality = 0;
+  ViewFrame CurrentViews = {};
+  bool FrameStarted = false;
+  std::chrono::steady_clock::time_point LapTime;
+};
@@ -1,12 +1,16 @@
 #include "HoverPickStyle.h"
 
-#include <vtkHardwarePicker.h>
+#include <vtkCamera.h>
 #include <vtkObjectFactory.h>
 #include <vtkPolyData.h>
 #include <vtkProperty.h>
 #include <vtkRenderWindowInteractor.h>
 #include <vtkRenderer.h>
 
+#include <array>
+#include <chrono>
+#include <utility>
+
 vtkStandardNewMacro(HoverPickStyle);
 
 HoverPickStyle::HoverPickStyle() = default;
@@ -16,14 +20,32 @@ void HoverPickStyle::SetDatasets(vtkPartitionedDataSetCollection *datasets) {
   this->Datasets = vtk::MakeSmartPointer(datasets);
 }
 
+void HoverPickStyle::AddInstancedActor(vtkActor *actor, vtkPolyData *mesh,
+                                       vtkPoints *centers) {
+  this->InstancedActors.push_back({vtk::MakeSmartPointer(actor),
+                                   vtk::MakeSmartPointer(mesh),
+                                   vtk::MakeSmartPointer(centers)});
+}
+
+void HoverPickStyle::AddMergedActor(vtkActor *actor, vtkPolyData *mesh,
+                                    vtkPoints *centers,
+                                    vtkIdTypeArray *cellInstanceIds) {
+  this->InstancedActors.push_back(
+      {vtk::MakeSmartPointer(actor), vtk::MakeSmartPointer(mesh),
+       vtk::MakeSmartPointer(centers), vtk::MakeSmartPointer(cellInstanceIds)});
+}
+
+void HoverPickStyle::RemoveAllInstancedActors() {
+  this->InstancedActors.clear();
+}
+
 void HoverPickStyle::Activate(vtkRenderer *renderer) {
   vtkNew<vtkPolyData> empty;
-  this->TransformFilter->SetTransform(this->Transform);
-  this->TransformFilter->SetInputData(empty);
-  this->SelectionMapper->SetInputConnection(
-      this->TransformFilter->GetOutputPort());
+  // the highlight is a matrix on the actor, the mesh is never re-executed.
+  this->SelectionMapper->SetInputData(empty);
   // this->SelectionMapper->SetScalarVisibility(false);
   this->SelectionActor->SetMapper(this->SelectionMapper);
+  this->SelectionActor->SetUserTransform(this->Transform);
   this->SelectionActor->GetProperty()->SetEdgeColor(1.0, 1.0, 1.0);
   this->SelectionActor->GetProperty()->SetEdgeVisibility(true);
   this->SelectionActor->GetProperty()->SetLineWidth(2);
@@ -33,37 +55,218 @@ void HoverPickStyle::Activate(vtkRenderer *renderer) {
   this->SelectionActor->GetProperty()->RenderPointsAsSpheresOn();
   this->SelectionActor->GetProperty()->SetPointSize(8);
   this->SelectionActor->SetPickable(false);
+  this->SelectionActor->SetVisibility(false);
   renderer->AddActor(this->SelectionActor);
+  this->HighlightRenderer = renderer;
+  this->InvalidateSelectionBuffers();
 }
 
 void HoverPickStyle::Deactivate(vtkRenderer *renderer) {
   renderer->RemoveActor(this->SelectionActor);
+  if (this->HighlightRenderer != nullptr) {
+    this->HighlightRenderer->RemoveActor(this->SelectionActor);
+  }
+  this->HighlightRenderer = nullptr;
+  if (this->PickTimerId >= 0 && this->Interactor != nullptr) {
+    this->Interactor->DestroyTimer(this->PickTimerId);
+  }
+  this->PickTimerId = -1;
+  this->PickPending = false;
+  this->InvalidateSelectionBuffers();
+}
+
+void HoverPickStyle::SetViewLocator(ViewLocator locator) {
+  this->LocateView = std::move(locator);
+}
+
+void HoverPickStyle::InvalidateSelectionBuffers() {
+  this->BuffersValid = false;
+  this->SelectionActor->SetVisibility(false);
+  this->HighlightedProp = nullptr;
+  this->HighlightedId = -1;
+}
+
+double HoverPickStyle::PopPickTime() {
+  const double pickTime = this->PickTime;
+  this->PickTime = 0;
+  return pickTime;
+}
+
+void HoverPickStyle::Highlight(vtkPolyData *mesh, const double offset[3]) {
+  if (this->SelectionMapper->GetInput() != mesh) {
+    this->SelectionMapper->SetInputData(mesh);
+  }
+  this->Transform->Identity();
+  // display a rod piercing the mesh.
+  double center[3] = {};
+  mesh->GetCenter(center);
+  this->Transform->Translate(center[0] + offset[0], center[1] + offset[1],
+                             center[2] + offset[2]);
+  this->Transform->Scale(1.2, 1.2, 1.2);
+  this->Transform->Translate(-center[0], -center[1], -center[2]);
+  this->SelectionActor->SetVisibility(true);
+}
+
+bool HoverPickStyle::UpdateSelectionBuffers(vtkRenderer *renderer) {
+  const int *size = renderer->GetSize();
+  // the clipping range is reset on every render, which bumps the camera's
+  // MTime. compare the parameters that move pixels instead.
+  auto camera = renderer->GetActiveCamera();
+  std::array<double, 12> view;
+  camera->GetPosition(view.data());
+  camera->GetFocalPoint(view.data() + 3);
+  camera->GetViewUp(view.data() + 6);
+  view[9] = camera->GetViewAngle();
+  view[10] = camera->GetParallelScale();
+  view[11] = camera->GetParallelProjection();
+  if (this->BuffersValid && this->Selector->GetRenderer() == renderer &&
+      view == this->CameraView &&
+      size[0] == this->ViewportSize[0] && size[1] == this->ViewportSize[1]) {
+    return true;
+  }
+  const int *origin = renderer->GetOrigin();
+  this->Selector->SetRenderer(renderer);
+  // glyph mappers report the picked instance as a point id.
+  const bool glyphs =
+      !this->InstancedActors.empty() &&
+      this->InstancedActors.front().CellInstanceIds == nullptr;
+  this->Selector->SetFieldAssociation(
+      glyphs ? vtkDataObject::FIELD_ASSOCIATION_POINTS
+             : vtkDataObject::FIELD_ASSOCIATION_CELLS);
+  this->Selector->SetArea(origin[0], origin[1], origin[0] + size[0] - 1,
+                          origin[1] + size[1] - 1);
+  this->BuffersValid = this->Selector->CaptureBuffers();
+  this->CameraView = view;
+  this->ViewportSize[0] = size[0];
+  this->ViewportSize[1] = size[1];
+  return this->BuffersValid;
+}
+
+bool HoverPickStyle::Pick(int x, int y) {
+  const auto startTime = std::chrono::steady_clock::now();
+  vtkProp *prop = nullptr;
+  vtkIdType id = -1;
+  double offset[3] = {0.0, 0.0, 0.0};
+  vtkPolyData *mesh = nullptr;
+
+  vtkRenderer *renderer =
+      this->LocateView ? this->LocateView(x, y) : this->GetDefaultRenderer();
+  if (renderer != nullptr && renderer != this->HighlightRenderer) {
+    // the highlight moves to the view the pointer is in.
+    if (this->HighlightRenderer != nullptr) {
+      this->HighlightRenderer->RemoveActor(this->SelectionActor);
+    }
+    renderer->AddActor(this->SelectionActor);
+    this->HighlightRenderer = renderer;
+    this->HighlightedProp = nullptr;
+    this->HighlightedId = -1;
+  }
+  if (renderer != nullptr && this->UpdateSelectionBuffers(renderer)) {
+    const unsigned int pos[2] = {static_cast<unsigned int>(x),
+                                 static_cast<unsigned int>(y)};
+    unsigned int selectedPos[2];
+    const auto info = this->Selector->GetPixelInformation(pos, 0, selectedPos);
+    if (info.Valid) {
+      prop = info.Prop;
+      if (!this->InstancedActors.empty()) {
+        for (const auto &instanced : this->InstancedActors) {
+          vtkIdType instanceId = info.AttributeID;
+          const auto &cellInstanceIds = instanced.CellInstanceIds;
+          if (prop != instanced.Actor.Get() || instanceId < 0) {
+            continue;
+          }
+          if (cellInstanceIds != nullptr) {
+            instanceId = instanceId < cellInstanceIds->GetNumberOfValues()
+                             ? cellInstanceIds->GetValue(instanceId)
+                             : -1;
+          }
+          if (instanceId >= 0 &&
+              instanceId < instanced.Centers->GetNumberOfPoints()) {
+            id = instanceId;
+            instanced.Centers->GetPoint(id, offset);
+            mesh = instanced.Mesh;
+          }
+        }
+      } else if (this->Datasets != nullptr && info.CompositeID > 0) {
+        id = info.CompositeID;
+        mesh = vtkPolyData::SafeDownCast(this->Datasets->GetDataSet(
+            static_cast<unsigned int>(info.CompositeID)));
+      }
+    }
+  }
+
+  bool changed = false;
+  if (mesh == nullptr) {
+    prop = nullptr;
+    id = -1;
+  }
+  if (prop != this->HighlightedProp || id != this->HighlightedId) {
+    // something was picked, enlarge it and show it with edges and points
+    // rendererd as spheres.
+    if (mesh != nullptr) {
+      this->Highlight(mesh, offset);
+    } else {
+      this->SelectionActor->SetVisibility(false);
+    }
+    this->HighlightedProp = prop;
+    this->HighlightedId = id;
+    changed = true;
+  }
+  const double pickTime = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - startTime)
+                             .count();
+  this->PickTime += pickTime;
+  this->TotalPickTime += pickTime;
+  return changed;
+}
+
+void HoverPickStyle::FlushPendingPick() {
+  if (!this->PickPending || this->Interactor == nullptr) {
+    return;
+  }
+  // forced before the timer fired, which would pick a second time.
+  if (this->PickTimerId >= 0) {
+    this->Interactor->DestroyTimer(this->PickTimerId);
+    this->PickTimerId = -1;
+  }
+  this->PickPending = false;
+  const int *pos = this->Interactor->GetEventPosition();
+  if (this->Pick(pos[0], pos[1])) {
+    this->Interactor->Render();
+  }
+}
+
+void HoverPickStyle::SetPickTimer(bool enabled) {
+  this->PickTimerEnabled = enabled;
+  if (!enabled && this->PickTimerId >= 0 && this->Interactor != nullptr) {
+    this->Interactor->DestroyTimer(this->PickTimerId);
+    this->PickTimerId = -1;
+  }
+}
+
+void HoverPickStyle::OnTimer() {
+  if (this->Interactor != nullptr &&
+      this->Interactor->GetTimerEventId() == this->PickTimerId) {
+    this->PickTimerId = -1;
+    this->FlushPendingPick();
+    return;
+  }
+  this->Superclass::OnTimer();
 }
 
 void HoverPickStyle::OnMouseMove() {
-  int *clickPos = this->GetInteractor()->GetEventPosition();
-  vtkNew<vtkHardwarePicker> picker;
-  // pick a dataset
-  picker->SnapToMeshPointOff();
-  picker->Pick(clickPos[0], clickPos[1], 0, this->GetDefaultRenderer());
-  const auto block_idx = picker->GetFlatBlockIndex();
-  // something was picked, enlarge it and show it with edges and points
-  // rendererd as spheres.
-  if (block_idx > 0) {
-    auto mesh =
-        vtkPolyData::SafeDownCast(this->Datasets->GetDataSet(block_idx));
-    this->TransformFilter->SetInputData(mesh);
-    this->Transform->Identity();
-    // display a rod piercing the mesh.
-    double center[3] = {};
-    mesh->GetCenter(center);
-    this->Transform->Translate(center);
-    this->Transform->Scale(1.2, 1.2, 1.2);
-    this->Transform->Translate(-center[0], -center[1], -center[2]);
-    this->SelectionActor->SetVisibility(true);
-  } else {
-    this->SelectionActor->SetVisibility(false);
+  // no picking while the camera moves, the buffers would be stale anyway.
+  if (this->State == VTKIS_NONE) {
+    this->PickPending = true;
+    if (this->PickTimerEnabled && this->PickTimerId < 0) {
+      this->PickTimerId =
+          this->Interactor->CreateOneShotTimer(this->PickInterval);
+      if (this->PickTimerId <= 0) {
+        // no timer support, pick right away.
+        this->PickTimerId = -1;
+        this->FlushPendingPick();
+      }
+    }
   }
-  this->GetInteractor()->Render();
   this->Superclass::OnMouseMove();
 }
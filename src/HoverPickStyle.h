@@ -1,12 +1,20 @@
 #pragma once
 
 #include <vtkActor.h>
+#include <vtkHardwareSelector.h>
+#include <vtkIdTypeArray.h>
 #include <vtkInteractorStyleTrackballCamera.h>
 #include <vtkPartitionedDataSetCollection.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkRenderer.h>
 #include <vtkTransform.h>
-#include <vtkTransformFilter.h>
+#include <vtkWeakPointer.h>
+
+#include <array>
+#include <functional>
+#include <vector>
 
 // Handle mouse events
 class HoverPickStyle : public vtkInteractorStyleTrackballCamera {
@@ -16,19 +24,87 @@ public:
 
   void SetDatasets(vtkPartitionedDataSetCollection *datasets);
 
+  // An instanced actor draws `mesh` once at each of the `centers`.
+  void AddInstancedActor(vtkActor *actor, vtkPolyData *mesh,
+                         vtkPoints *centers);
+  // A merged actor draws copies of `mesh` at the `centers` in a single batch.
+  // `cellInstanceIds` holds the index into `centers` of every drawn cell.
+  void AddMergedActor(vtkActor *actor, vtkPolyData *mesh, vtkPoints *centers,
+                      vtkIdTypeArray *cellInstanceIds);
+  void RemoveAllInstancedActors();
+
   void Activate(vtkRenderer *renderer);
   void Deactivate(vtkRenderer* renderer);
 
+  // Returns the view at a display position, picks happen in that view and
+  // the highlight is drawn there. Without it, the default renderer is used.
+  using ViewLocator = std::function<vtkRenderer *(int x, int y)>;
+  void SetViewLocator(ViewLocator locator);
+
+  // The selection buffers are captured once and reused until the camera or
+  // the viewport changes. Call this when anything else visible changes.
+  void InvalidateSelectionBuffers();
+
+  // Mouse moves only record the position. The pick runs at most once every
+  // `PickInterval` milliseconds, from a one shot timer.
+  vtkSetMacro(PickInterval, unsigned long);
+  vtkGetMacro(PickInterval, unsigned long);
+  // Runs the pending pick right away, if there is one.
+  void FlushPendingPick();
+  // Without the timer, mouse moves only leave a pick pending until
+  // FlushPendingPick, like during replays.
+  void SetPickTimer(bool enabled);
+
+  // Time spent in picking since the last call, in milliseconds.
+  double PopPickTime();
+  // Time spent in picking since creation, in milliseconds.
+  vtkGetMacro(TotalPickTime, double);
+
   void OnMouseMove() override;
+  void OnTimer() override;
 
 protected:
   HoverPickStyle();
   ~HoverPickStyle() override;
 
 private:
+  struct InstancedActor {
+    vtkSmartPointer<vtkActor> Actor;
+    vtkSmartPointer<vtkPolyData> Mesh;
+    vtkSmartPointer<vtkPoints> Centers;
+    // null for instanced actors, whose picks are already instance ids.
+    vtkSmartPointer<vtkIdTypeArray> CellInstanceIds;
+  };
+
+  // Highlights `mesh` after moving it by `offset`.
+  void Highlight(vtkPolyData *mesh, const double offset[3]);
+  // Returns true when the highlighted object changed.
+  bool Pick(int x, int y);
+  bool UpdateSelectionBuffers(vtkRenderer *renderer);
+
   vtkSmartPointer<vtkPartitionedDataSetCollection> Datasets;
+  std::vector<InstancedActor> InstancedActors;
   vtkNew<vtkTransform> Transform;
-  vtkNew<vtkTransformFilter> TransformFilter;
   vtkNew<vtkActor> SelectionActor;
   vtkNew<vtkPolyDataMapper> SelectionMapper;
+
+  ViewLocator LocateView;
+  // view the selection actor is in.
+  vtkWeakPointer<vtkRenderer> HighlightRenderer;
+
+  vtkNew<vtkHardwareSelector> Selector;
+  bool BuffersValid = false;
+  std::array<double, 12> CameraView = {};
+  int ViewportSize[2] = {0, 0};
+
+  // What is highlighted now: a prop and a block or instance index.
+  vtkProp *HighlightedProp = nullptr;
+  vtkIdType HighlightedId = -1;
+
+  unsigned long PickInterval = 16;
+  int PickTimerId = -1;
+  bool PickTimerEnabled = true;
+  bool PickPending = false;
+  double PickTime = 0;
+  double TotalPickTime = 0;
 };
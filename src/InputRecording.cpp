@@ -0,0 +1,114 @@
+#include "InputRecording.h"
+
+#include <vtkCommand.h>
+
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace {
+// True when every value of the line was read and nothing is left.
+bool IsComplete(std::istringstream &line) {
+  std::string extra;
+  return !line.fail() && !(line >> extra);
+}
+} // namespace
+
+bool InputRecording::Parse(const std::string &text, InputRecording &recording,
+                           std::string &error) {
+  InputRecording parsed;
+  std::istringstream lines(text);
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(lines, line)) {
+    ++lineNumber;
+    line = line.substr(0, line.find('#'));
+    std::istringstream tokens(line);
+    std::string time, name;
+    if (!(tokens >> time)) {
+      continue;
+    }
+    Event event;
+    std::istringstream timeToken(time);
+    timeToken >> event.time;
+    if (!IsComplete(timeToken)) {
+      error = "line " + std::to_string(lineNumber) + ": invalid time";
+      return false;
+    }
+    tokens >> name;
+    bool valid = false;
+    if (name == "size") {
+      event.kind = Size;
+      tokens >> event.position[0] >> event.position[1];
+      valid = IsComplete(tokens) && event.position[0] > 0 &&
+              event.position[1] > 0;
+    } else if (name == "pick") {
+      event.kind = Pick;
+      tokens >> event.pick;
+      valid = IsComplete(tokens) && (event.pick == "none" ||
+                                     event.pick == "area" ||
+                                     event.pick == "hover");
+    } else if (name == "camera") {
+      event.kind = Camera;
+      for (auto &value : event.camera) {
+        tokens >> value;
+      }
+      valid = IsComplete(tokens);
+    } else {
+      event.eventId = vtkCommand::GetEventIdFromString(name.c_str());
+      tokens >> event.position[0] >> event.position[1] >> event.modifiers >>
+          event.repeatCount >> event.keyCode >> event.keySym;
+      if (event.keySym == "-") {
+        event.keySym.clear();
+      }
+      valid = IsComplete(tokens) && event.eventId != vtkCommand::NoEvent;
+    }
+    if (valid && !parsed.events.empty() &&
+        event.time < parsed.events.back().time) {
+      error = "line " + std::to_string(lineNumber) + ": time goes back";
+      return false;
+    } else if (!valid) {
+      error = "line " + std::to_string(lineNumber) + ": invalid '" + name + "'";
+      return false;
+    }
+    parsed.events.push_back(std::move(event));
+  }
+  recording = std::move(parsed);
+  return true;
+}
+
+std::string InputRecording::ToString() const {
+  std::ostringstream out;
+  for (const auto &event : this->events) {
+    out << std::fixed << std::setprecision(3) << event.time << ' ';
+    out << std::defaultfloat;
+    switch (event.kind) {
+    case Size:
+      out << "size " << event.position[0] << ' ' << event.position[1];
+      break;
+    case Pick:
+      out << "pick " << event.pick;
+      break;
+    case Camera:
+      // every digit, so that replays start from the same camera.
+      out << "camera" << std::setprecision(
+                             std::numeric_limits<double>::max_digits10);
+      for (const auto &value : event.camera) {
+        out << ' ' << value;
+      }
+      break;
+    default:
+      out << vtkCommand::GetStringFromEventId(event.eventId) << ' '
+          << event.position[0] << ' ' << event.position[1] << ' '
+          << event.modifiers << ' ' << event.repeatCount << ' '
+          << event.keyCode << ' '
+          << (event.keySym.empty() ? std::string("-") : event.keySym);
+    }
+    out << '\n';
+  }
+  return out.str();
+}
+
+double InputRecording::GetDuration() const {
+  return this->events.empty() ? 0.0 : this->events.back().time;
+}
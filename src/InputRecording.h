@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Input of an interactive session: the interactor events with the time they
+// were received, and the window size, pick type and camera changes made
+// through the app in between. A replay only depends on this text, see
+// BenchmarkApp::StartReplay.
+//
+// Text format, one event per line, `#` starts a comment. Times are in ms
+// since the start of the recording and never decrease:
+//   <ms> size <width> <height>
+//   <ms> pick none|area|hover
+//   <ms> camera <position xyz> <focal point xyz> <view up xyz> <view angle>
+//   <ms> <event> <x> <y> <modifiers> <repeat count> <key code> <key sym>
+// where <event> is a vtkCommand event name like MouseMoveEvent, the modifiers
+// add up 1 for control, 2 for shift and 4 for alt, and the key sym is `-`
+// when there is none.
+struct InputRecording {
+  enum Kind { Interaction = 0, Size, Pick, Camera };
+  enum Modifier { Control = 1, Shift = 2, Alt = 4 };
+  struct Event {
+    double time = 0;
+    Kind kind = Interaction;
+    // vtkCommand::EventIds, interactions only.
+    unsigned long eventId = 0;
+    // event position, or the window size.
+    std::array<int, 2> position = {0, 0};
+    int modifiers = 0;
+    int repeatCount = 0;
+    int keyCode = 0;
+    std::string keySym;
+    std::string pick;
+    // position, focal point, view up and view angle.
+    std::array<double, 10> camera = {};
+  };
+
+  std::vector<Event> events;
+
+  // Returns false and describes the first invalid line in `error`.
+  // `recording` is left untouched then.
+  static bool Parse(const std::string &text, InputRecording &recording,
+                    std::string &error);
+  // Text that parses back into the same events.
+  std::string ToString() const;
+  // Time of the last event in ms.
+  double GetDuration() const;
+};
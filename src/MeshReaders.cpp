@@ -0,0 +1,199 @@
+#include "MeshReaders.h"
+
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkPoints.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+// Visits every line of the buffer. `line` is reused, so only one line is
+// ever copied at a time.
+template <typename Functor>
+void ForEachLine(const char *data, std::size_t size, Functor &&functor) {
+  std::string line;
+  const char *end = data + size;
+  for (const char *begin = data; begin < end;) {
+    auto eol = static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+    if (eol == nullptr) {
+      eol = end;
+    }
+    line.assign(begin, eol);
+    functor(line);
+    begin = eol + 1;
+  }
+}
+
+// Skips leading white space.
+const char *SkipSpaces(const char *str) {
+  while (*str == ' ' || *str == '\t') {
+    ++str;
+  }
+  return str;
+}
+
+vtkSmartPointer<vtkPolyData> ReadBinarySTL(const char *data,
+                                           std::uint32_t numTriangles) {
+  vtkNew<vtkFloatArray> coords;
+  coords->SetNumberOfComponents(3);
+  coords->SetNumberOfTuples(3 * vtkIdType(numTriangles));
+  vtkNew<vtkFloatArray> normals;
+  normals->SetName("Normals");
+  normals->SetNumberOfComponents(3);
+  normals->SetNumberOfTuples(numTriangles);
+  float *xyz = coords->GetPointer(0);
+  float *nxyz = normals->GetPointer(0);
+  // normal, 3 vertices and a 2 byte attribute per triangle.
+  const char *record = data + 84;
+  for (std::uint32_t i = 0; i < numTriangles; ++i, record += 50) {
+    std::memcpy(nxyz + 3 * i, record, 3 * sizeof(float));
+    std::memcpy(xyz + 9 * i, record + 12, 9 * sizeof(float));
+  }
+
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfValues(3 * vtkIdType(numTriangles));
+  for (vtkIdType i = 0; i < connectivity->GetNumberOfValues(); ++i) {
+    connectivity->SetValue(i, i);
+  }
+  vtkNew<vtkCellArray> polys;
+  polys->SetData(3, connectivity);
+
+  vtkNew<vtkPoints> points;
+  points->SetData(coords);
+  auto mesh = vtkSmartPointer<vtkPolyData>::New();
+  mesh->SetPoints(points);
+  mesh->SetPolys(polys);
+  mesh->GetCellData()->SetNormals(normals);
+  return mesh;
+}
+
+vtkSmartPointer<vtkPolyData> ReadASCIISTL(const char *data, std::size_t size) {
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToFloat();
+  vtkNew<vtkCellArray> polys;
+  vtkIdType facet[3];
+  int numFacetPoints = 0;
+  ForEachLine(data, size, [&](const std::string &line) {
+    const char *str = SkipSpaces(line.c_str());
+    if (std::strncmp(str, "vertex", 6) == 0) {
+      char *next = nullptr;
+      const double x = std::strtod(str + 6, &next);
+      const double y = std::strtod(next, &next);
+      const double z = std::strtod(next, &next);
+      const vtkIdType ptId = points->InsertNextPoint(x, y, z);
+      if (numFacetPoints < 3) {
+        facet[numFacetPoints++] = ptId;
+      }
+    } else if (std::strncmp(str, "endfacet", 8) == 0) {
+      if (numFacetPoints == 3) {
+        polys->InsertNextCell(3, facet);
+      }
+      numFacetPoints = 0;
+    }
+  });
+  auto mesh = vtkSmartPointer<vtkPolyData>::New();
+  mesh->SetPoints(points);
+  mesh->SetPolys(polys);
+  return mesh;
+}
+} // namespace
+
+vtkSmartPointer<vtkPolyData> ReadSTLFromMemory(const char *data,
+                                               std::size_t size) {
+  if (data == nullptr || size < 84) {
+    return nullptr;
+  }
+  // ASCII files start with "solid", but so do the headers of some binary
+  // files. The size of a binary file is fully determined by its header.
+  std::uint32_t numTriangles = 0;
+  std::memcpy(&numTriangles, data + 80, sizeof(numTriangles));
+  if (size == 84 + 50 * std::size_t(numTriangles)) {
+    return ::ReadBinarySTL(data, numTriangles);
+  }
+  if (std::strncmp(data, "solid", 5) == 0) {
+    return ::ReadASCIISTL(data, size);
+  }
+  return nullptr;
+}
+
+vtkSmartPointer<vtkPolyData> ReadOBJFromMemory(const char *data,
+                                               std::size_t size) {
+  if (data == nullptr) {
+    return nullptr;
+  }
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToFloat();
+  vtkNew<vtkCellArray> verts;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkCellArray> polys;
+  std::vector<vtkIdType> cell;
+  vtkIdType numInvalidCells = 0;
+  ForEachLine(data, size, [&](const std::string &line) {
+    const char *str = SkipSpaces(line.c_str());
+    const char type = str[0];
+    if (type == 'v' && (str[1] == ' ' || str[1] == '\t')) {
+      char *next = nullptr;
+      const double x = std::strtod(str + 1, &next);
+      const double y = std::strtod(next, &next);
+      const double z = std::strtod(next, &next);
+      points->InsertNextPoint(x, y, z);
+      return;
+    }
+    if ((type != 'f' && type != 'l' && type != 'p') ||
+        (str[1] != ' ' && str[1] != '\t')) {
+      return;
+    }
+    // "f 1 2 3", "f 1/1/1 2/2/2 3/3/3", "f -3 -2 -1" ..
+    cell.clear();
+    const vtkIdType numPoints = points->GetNumberOfPoints();
+    char *next = const_cast<char *>(str + 1);
+    for (;;) {
+      char *tokenEnd = nullptr;
+      const long index = std::strtol(next, &tokenEnd, 10);
+      if (tokenEnd == next) {
+        break;
+      }
+      cell.push_back(index < 0 ? numPoints + index : index - 1);
+      // skip texture coordinate and normal indices.
+      next = tokenEnd;
+      while (*next != '\0' && *next != ' ' && *next != '\t') {
+        ++next;
+      }
+    }
+    if (cell.empty()) {
+      return;
+    }
+    // "f 0" or indices past the points read so far would crash the mapper.
+    if (std::any_of(cell.begin(), cell.end(), [numPoints](vtkIdType ptId) {
+          return ptId < 0 || ptId >= numPoints;
+        })) {
+      ++numInvalidCells;
+      return;
+    }
+    auto cells = type == 'f' ? polys.Get() : (type == 'l' ? lines.Get()
+                                                          : verts.Get());
+    cells->InsertNextCell(static_cast<vtkIdType>(cell.size()), cell.data());
+  });
+  if (numInvalidCells > 0) {
+    std::cerr << "Skipped " << numInvalidCells
+              << " OBJ cells with invalid point indices" << std::endl;
+  }
+  auto mesh = vtkSmartPointer<vtkPolyData>::New();
+  mesh->SetPoints(points);
+  if (verts->GetNumberOfCells() > 0) {
+    mesh->SetVerts(verts);
+  }
+  if (lines->GetNumberOfCells() > 0) {
+    mesh->SetLines(lines);
+  }
+  mesh->SetPolys(polys);
+  return mesh;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <cstddef>
+
+// Parsers that read straight out of a memory buffer, without copying it into
+// a std::string or a file first. Return nullptr when the buffer is invalid.
+
+// Binary or ASCII STL. Triangles are not merged.
+vtkSmartPointer<vtkPolyData> ReadSTLFromMemory(const char *data,
+                                               std::size_t size);
+
+// Wavefront OBJ. Only vertices, lines and polygonal faces are read.
+vtkSmartPointer<vtkPolyData> ReadOBJFromMemory(const char *data,
+                                               std::size_t size);
@@ -0,0 +1,488 @@
+#include "SceneCache.h"
+
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char Magic[8] = {'V', 'T', 'K', 'W', 'S', 'C', 'N', 'E'};
+const std::uint32_t Version = 2;
+// point data and cell data arrays kept per partition.
+const int MaxArrays = 4;
+// every section starts at a multiple of this.
+const std::size_t Alignment = 16;
+
+struct Header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t numLayers;
+  std::uint64_t numBlocks;
+  std::uint64_t numLevels;
+  std::uint64_t numArrays;
+  std::uint64_t numColors;
+  std::uint64_t descriptionSize;
+  std::uint64_t generator;
+};
+
+struct ArrayRecord {
+  char name[32];
+  std::int32_t type;
+  std::int32_t numComponents;
+  std::uint64_t numTuples;
+  // from the start of the snapshot.
+  std::uint64_t offset;
+};
+
+// Indices in the array table, -1 for none.
+struct PartitionRecord {
+  std::int64_t points;
+  // offsets and connectivity of the verts, lines, polys and strips.
+  std::int64_t cells[4][2];
+  std::int64_t pointData[MaxArrays];
+  std::int64_t cellData[MaxArrays];
+  // slots of the active attributes in pointData and cellData.
+  std::int32_t normals;
+  std::int32_t scalars;
+  std::int32_t cellScalars;
+  std::int32_t padding;
+};
+
+struct ColorRecord {
+  std::int64_t blockId;
+  double rgb[3];
+};
+
+std::size_t Align(std::size_t offset) {
+  return (offset + Alignment - 1) / Alignment * Alignment;
+}
+
+// Offsets of the sections, they only depend on the header.
+struct Layout {
+  std::size_t arrays, partitions, layerSizes, layerIds, visibility, colors,
+      bounds, description, data;
+
+  Layout(const Header &header, std::uint64_t numLayerIds) {
+    this->arrays = Align(sizeof(Header));
+    this->partitions =
+        Align(this->arrays + header.numArrays * sizeof(ArrayRecord));
+    this->layerSizes =
+        Align(this->partitions + header.numBlocks * header.numLevels *
+                                     sizeof(PartitionRecord));
+    this->layerIds =
+        Align(this->layerSizes + header.numLayers * sizeof(std::uint64_t));
+    this->visibility =
+        Align(this->layerIds + numLayerIds * sizeof(std::int64_t));
+    this->colors = Align(this->visibility + header.numBlocks);
+    this->bounds =
+        Align(this->colors + header.numColors * sizeof(ColorRecord));
+    this->description = Align(this->bounds + header.numBlocks *
+                                                 sizeof(BlockBVH::Bounds));
+    this->data = Align(this->description + header.descriptionSize);
+  }
+};
+
+// vtkCellArray only uses the fixed-width arrays without copying them.
+vtkSmartPointer<vtkDataArray> CreateArray(int type) {
+  const bool signedInteger = type == VTK_INT || type == VTK_LONG ||
+                             type == VTK_LONG_LONG || type == VTK_ID_TYPE;
+  if (signedInteger && vtkDataArray::GetDataTypeSize(type) == 8) {
+    return vtkSmartPointer<vtkTypeInt64Array>::New();
+  } else if (signedInteger && vtkDataArray::GetDataTypeSize(type) == 4) {
+    return vtkSmartPointer<vtkTypeInt32Array>::New();
+  }
+  return vtkSmartPointer<vtkDataArray>::Take(
+      vtkDataArray::CreateDataArray(type));
+}
+
+template <typename T>
+void WriteAt(std::vector<char> &out, std::size_t offset, const T *values,
+             std::size_t count) {
+  if (count > 0) {
+    std::memcpy(out.data() + offset, values, count * sizeof(T));
+  }
+}
+} // namespace
+
+std::unique_ptr<SceneCache::Buffer>
+SceneCache::Buffer::MapFile(const std::string &filename) {
+  std::unique_ptr<Buffer> buffer(new Buffer());
+#ifndef _WIN32
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+  // private pages, the arrays may be written to without touching the file.
+  void *data = mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                    PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+  buffer->Data = static_cast<char *>(data);
+  buffer->Size = static_cast<std::size_t>(info.st_size);
+  buffer->Mapped = true;
+#else
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  if (!file || file.tellg() <= 0) {
+    return nullptr;
+  }
+  buffer->Size = static_cast<std::size_t>(file.tellg());
+  buffer->Data = static_cast<char *>(std::malloc(buffer->Size));
+  file.seekg(0);
+  if (buffer->Data == nullptr || !file.read(buffer->Data, buffer->Size)) {
+    return nullptr;
+  }
+#endif
+  return buffer;
+}
+
+std::unique_ptr<SceneCache::Buffer>
+SceneCache::Buffer::Adopt(void *data, std::size_t size) {
+  std::unique_ptr<Buffer> buffer(new Buffer());
+  buffer->Data = static_cast<char *>(data);
+  buffer->Size = size;
+  return buffer;
+}
+
+SceneCache::Buffer::~Buffer() {
+#ifndef _WIN32
+  if (this->Mapped) {
+    munmap(this->Data, this->Size);
+    return;
+  }
+#endif
+  std::free(this->Data);
+}
+
+void SceneCache::Write(vtkPartitionedDataSetCollection *meshes,
+                       std::vector<char> &out) const {
+  Header header = {};
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.numLayers = static_cast<std::uint32_t>(this->Layers.size());
+  header.numBlocks = meshes->GetNumberOfPartitionedDataSets();
+  for (unsigned int i = 0; i < header.numBlocks; ++i) {
+    header.numLevels = std::max<std::uint64_t>(
+        header.numLevels, meshes->GetNumberOfPartitions(i));
+  }
+  header.numColors = this->Colors.size();
+  header.descriptionSize = this->Description.size();
+  header.generator = this->Generator;
+
+  // every distinct array once, shared ones are referenced by their index.
+  std::vector<vtkDataArray *> arrays;
+  std::unordered_map<vtkAbstractArray *, std::int64_t> indices;
+  auto addArray = [&](vtkAbstractArray *array) -> std::int64_t {
+    auto dataArray = vtkDataArray::SafeDownCast(array);
+    if (dataArray == nullptr || !dataArray->HasStandardMemoryLayout()) {
+      return -1;
+    }
+    const auto it = indices.find(array);
+    if (it != indices.end()) {
+      return it->second;
+    }
+    arrays.push_back(dataArray);
+    return indices[array] = static_cast<std::int64_t>(arrays.size() - 1);
+  };
+  std::vector<PartitionRecord> partitions(header.numBlocks * header.numLevels);
+  for (unsigned int i = 0; i < header.numBlocks; ++i) {
+    for (unsigned int level = 0; level < header.numLevels; ++level) {
+      auto &record = partitions[i * header.numLevels + level];
+      std::fill_n(&record.cells[0][0], 8, -1);
+      std::fill_n(record.pointData, MaxArrays, -1);
+      std::fill_n(record.cellData, MaxArrays, -1);
+      record.points = -1;
+      record.normals = record.scalars = record.cellScalars = -1;
+      vtkPolyData *mesh = nullptr;
+      if (level < meshes->GetNumberOfPartitions(i)) {
+        mesh = vtkPolyData::SafeDownCast(meshes->GetPartition(i, level));
+      }
+      if (mesh == nullptr || mesh->GetPoints() == nullptr) {
+        continue;
+      }
+      record.points = addArray(mesh->GetPoints()->GetData());
+      vtkCellArray *cells[4] = {mesh->GetVerts(), mesh->GetLines(),
+                                mesh->GetPolys(), mesh->GetStrips()};
+      for (int type = 0; type < 4; ++type) {
+        if (cells[type] != nullptr && cells[type]->GetNumberOfCells() > 0) {
+          record.cells[type][0] = addArray(cells[type]->GetOffsetsArray());
+          record.cells[type][1] = addArray(cells[type]->GetConnectivityArray());
+        }
+      }
+      auto pointData = mesh->GetPointData();
+      for (int slot = 0;
+           slot < std::min(pointData->GetNumberOfArrays(), MaxArrays); ++slot) {
+        auto array = pointData->GetAbstractArray(slot);
+        record.pointData[slot] = addArray(array);
+        if (array == pointData->GetNormals()) {
+          record.normals = slot;
+        } else if (array == pointData->GetScalars()) {
+          record.scalars = slot;
+        }
+      }
+      auto cellData = mesh->GetCellData();
+      for (int slot = 0;
+           slot < std::min(cellData->GetNumberOfArrays(), MaxArrays); ++slot) {
+        auto array = cellData->GetAbstractArray(slot);
+        record.cellData[slot] = addArray(array);
+        if (array == cellData->GetScalars()) {
+          record.cellScalars = slot;
+        }
+      }
+    }
+  }
+  header.numArrays = arrays.size();
+
+  std::uint64_t numLayerIds = 0;
+  std::vector<std::uint64_t> layerSizes;
+  for (const auto &layer : this->Layers) {
+    layerSizes.push_back(layer.size());
+    numLayerIds += layer.size();
+  }
+  const Layout layout(header, numLayerIds);
+  std::vector<ArrayRecord> records(arrays.size());
+  std::size_t offset = layout.data;
+  for (std::size_t i = 0; i < arrays.size(); ++i) {
+    auto &record = records[i];
+    std::memset(record.name, 0, sizeof(record.name));
+    if (const char *name = arrays[i]->GetName()) {
+      std::strncpy(record.name, name, sizeof(record.name) - 1);
+    }
+    record.type = arrays[i]->GetDataType();
+    record.numComponents = arrays[i]->GetNumberOfComponents();
+    record.numTuples =
+        static_cast<std::uint64_t>(arrays[i]->GetNumberOfTuples());
+    record.offset = offset;
+    offset = Align(offset + record.numTuples * record.numComponents *
+                                arrays[i]->GetDataTypeSize());
+  }
+
+  out.assign(offset, 0);
+  WriteAt(out, 0, &header, 1);
+  WriteAt(out, layout.arrays, records.data(), records.size());
+  WriteAt(out, layout.partitions, partitions.data(), partitions.size());
+  WriteAt(out, layout.layerSizes, layerSizes.data(), layerSizes.size());
+  std::size_t idOffset = layout.layerIds;
+  for (const auto &layer : this->Layers) {
+    for (const auto &blockId : layer) {
+      const std::int64_t id = blockId;
+      WriteAt(out, idOffset, &id, 1);
+      idOffset += sizeof(id);
+    }
+  }
+  WriteAt(out, layout.visibility, this->Visibility.data(),
+          std::min<std::size_t>(this->Visibility.size(), header.numBlocks));
+  for (std::size_t i = 0; i < this->Colors.size(); ++i) {
+    const ColorRecord record = {this->Colors[i].first,
+                                {this->Colors[i].second[0],
+                                 this->Colors[i].second[1],
+                                 this->Colors[i].second[2]}};
+    WriteAt(out, layout.colors + i * sizeof(ColorRecord), &record, 1);
+  }
+  WriteAt(out, layout.bounds, this->Bounds.data(),
+          std::min<std::size_t>(this->Bounds.size(), header.numBlocks));
+  WriteAt(out, layout.description, this->Description.data(),
+          this->Description.size());
+  for (std::size_t i = 0; i < arrays.size(); ++i) {
+    WriteAt(out, records[i].offset,
+            static_cast<const char *>(arrays[i]->GetVoidPointer(0)),
+            records[i].numTuples * records[i].numComponents *
+                arrays[i]->GetDataTypeSize());
+  }
+}
+
+bool SceneCache::Read(char *data, std::size_t size,
+                      vtkPartitionedDataSetCollection *meshes,
+                      std::string &error) {
+  Header header;
+  if (size < sizeof(Header)) {
+    error = "truncated header";
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(Header));
+  if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+    error = "not a scene cache";
+    return false;
+  } else if (header.version != Version) {
+    error = "version " + std::to_string(header.version) + " instead of " +
+            std::to_string(Version);
+    return false;
+  }
+  // the section sizes are checked before anything points into them, each
+  // count is bounded by the size first so that they cannot overflow.
+  const Layout partial(header, 0);
+  if (header.numLayers > 255 || header.numLevels > 255 ||
+      header.numBlocks > size || header.numArrays > size ||
+      header.numColors > size || header.descriptionSize > size ||
+      partial.layerIds > size) {
+    error = "truncated tables";
+    return false;
+  }
+  std::vector<std::uint64_t> layerSizes(header.numLayers);
+  std::memcpy(layerSizes.data(), data + partial.layerSizes,
+              header.numLayers * sizeof(std::uint64_t));
+  std::uint64_t numLayerIds = 0;
+  for (const auto &layerSize : layerSizes) {
+    numLayerIds += std::min<std::uint64_t>(layerSize, size + 1);
+  }
+  const Layout layout(header, numLayerIds);
+  if (numLayerIds > size || layout.data > size) {
+    error = "truncated tables";
+    return false;
+  }
+
+  const auto *records =
+      reinterpret_cast<const ArrayRecord *>(data + layout.arrays);
+  std::vector<vtkSmartPointer<vtkDataArray>> arrays(header.numArrays);
+  for (std::uint64_t i = 0; i < header.numArrays; ++i) {
+    const auto &record = records[i];
+    auto array = ::CreateArray(record.type);
+    if (array == nullptr || record.numComponents <= 0 ||
+        record.offset % Alignment != 0 ||
+        record.offset + record.numTuples * record.numComponents *
+                                array->GetDataTypeSize() >
+            size) {
+      error = "invalid array " + std::to_string(i);
+      return false;
+    }
+    char name[sizeof(record.name) + 1] = {};
+    std::memcpy(name, record.name, sizeof(record.name));
+    array->SetName(name);
+    array->SetNumberOfComponents(record.numComponents);
+    // no copy, and the snapshot buffer is not freed with the array.
+    array->SetVoidArray(data + record.offset,
+                        static_cast<vtkIdType>(record.numTuples *
+                                               record.numComponents),
+                        1);
+    arrays[i] = array;
+  }
+  auto getArray = [&](std::int64_t index) -> vtkDataArray * {
+    return index >= 0 && static_cast<std::uint64_t>(index) < arrays.size()
+               ? arrays[index].Get()
+               : nullptr;
+  };
+
+  // shared offsets and connectivity make shared cell arrays.
+  const auto *partitionRecords =
+      reinterpret_cast<const PartitionRecord *>(data + layout.partitions);
+  const std::uint64_t numPartitions = header.numBlocks * header.numLevels;
+  std::map<std::pair<std::int64_t, std::int64_t>,
+           vtkSmartPointer<vtkCellArray>>
+      cellArrays;
+  for (std::uint64_t i = 0; i < numPartitions; ++i) {
+    for (const auto &cells : partitionRecords[i].cells) {
+      auto offsets = getArray(cells[0]), connectivity = getArray(cells[1]);
+      if (offsets != nullptr && connectivity != nullptr &&
+          cellArrays.count({cells[0], cells[1]}) == 0) {
+        vtkNew<vtkCellArray> cellArray;
+        cellArray->SetData(offsets, connectivity);
+        cellArrays[{cells[0], cells[1]}] = cellArray;
+      }
+    }
+  }
+  // the partitions only reference arrays, they are created in parallel.
+  std::vector<vtkSmartPointer<vtkPolyData>> partitions(numPartitions);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(numPartitions),
+                   [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i) {
+      const auto &record = partitionRecords[i];
+      auto points = getArray(record.points);
+      if (points == nullptr || points->GetNumberOfComponents() != 3) {
+        continue;
+      }
+      auto mesh = vtkSmartPointer<vtkPolyData>::New();
+      vtkNew<vtkPoints> meshPoints;
+      meshPoints->SetData(points);
+      mesh->SetPoints(meshPoints);
+      vtkCellArray *cells[4] = {};
+      for (int type = 0; type < 4; ++type) {
+        const auto it = cellArrays.find(
+            {record.cells[type][0], record.cells[type][1]});
+        cells[type] = it != cellArrays.end() ? it->second.Get() : nullptr;
+      }
+      mesh->SetVerts(cells[0]);
+      mesh->SetLines(cells[1]);
+      mesh->SetPolys(cells[2]);
+      mesh->SetStrips(cells[3]);
+      for (int slot = 0; slot < MaxArrays; ++slot) {
+        if (auto array = getArray(record.pointData[slot])) {
+          if (slot == record.normals) {
+            mesh->GetPointData()->SetNormals(array);
+          } else if (slot == record.scalars) {
+            mesh->GetPointData()->SetScalars(array);
+          } else {
+            mesh->GetPointData()->AddArray(array);
+          }
+        }
+        if (auto array = getArray(record.cellData[slot])) {
+          if (slot == record.cellScalars) {
+            mesh->GetCellData()->SetScalars(array);
+          } else {
+            mesh->GetCellData()->AddArray(array);
+          }
+        }
+      }
+      partitions[i] = mesh;
+    }
+  });
+  meshes->SetNumberOfPartitionedDataSets(
+      static_cast<unsigned int>(header.numBlocks));
+  for (std::uint64_t i = 0; i < numPartitions; ++i) {
+    if (partitions[i] != nullptr) {
+      meshes->SetPartition(static_cast<unsigned int>(i / header.numLevels),
+                           static_cast<unsigned int>(i % header.numLevels),
+                           partitions[i]);
+    }
+  }
+
+  this->Layers.assign(header.numLayers, {});
+  const auto *layerIds =
+      reinterpret_cast<const std::int64_t *>(data + layout.layerIds);
+  for (std::uint32_t layer = 0; layer < header.numLayers; ++layer) {
+    this->Layers[layer].assign(layerIds, layerIds + layerSizes[layer]);
+    layerIds += layerSizes[layer];
+  }
+  const auto *visibility =
+      reinterpret_cast<const unsigned char *>(data + layout.visibility);
+  this->Visibility.assign(visibility, visibility + header.numBlocks);
+  const auto *colors =
+      reinterpret_cast<const ColorRecord *>(data + layout.colors);
+  this->Colors.resize(header.numColors);
+  for (std::uint64_t i = 0; i < header.numColors; ++i) {
+    this->Colors[i] = {colors[i].blockId,
+                       {colors[i].rgb[0], colors[i].rgb[1], colors[i].rgb[2]}};
+  }
+  const auto *bounds =
+      reinterpret_cast<const BlockBVH::Bounds *>(data + layout.bounds);
+  this->Bounds.assign(bounds, bounds + header.numBlocks);
+  this->Description.assign(data + layout.description, header.descriptionSize);
+  this->Generator = header.generator;
+  return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "BlockAttributes.h"
+#include "BlockBVH.h"
+
+#include <vtkPartitionedDataSetCollection.h>
+#include <vtkType.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Binary snapshot of the composite blocks of a scene, with the layers, the
+// block attributes and the block bounds. Arrays are stored raw and aligned,
+// so that reading a snapshot points the data arrays of the partitions into
+// the buffer instead of parsing or copying them. Arrays shared by several
+// partitions, like the cells of generated blocks, are stored once.
+class SceneCache {
+public:
+  // Memory the arrays of a snapshot point into. It must outlive them.
+  class Buffer {
+  public:
+    // Maps a file copy-on-write, or reads it where mmap is not available.
+    // Returns nullptr when the file cannot be read.
+    static std::unique_ptr<Buffer> MapFile(const std::string &filename);
+    // Takes ownership of a buffer allocated with malloc.
+    static std::unique_ptr<Buffer> Adopt(void *data, std::size_t size);
+    ~Buffer();
+
+    char *GetData() const { return this->Data; }
+    std::size_t GetSize() const { return this->Size; }
+
+  private:
+    Buffer() = default;
+    char *Data = nullptr;
+    std::size_t Size = 0;
+    bool Mapped = false;
+  };
+
+  // Scene description of generated blocks, empty for loaded files.
+  std::string Description;
+  // Identifies the primitives and the layout the blocks were generated with,
+  // the same description gives other blocks once those change.
+  std::uint64_t Generator = 0;
+  // Block ids of every layer.
+  std::vector<std::vector<vtkIdType>> Layers;
+  // One value per block. Colors only list the blocks with an override.
+  std::vector<unsigned char> Visibility;
+  std::vector<std::pair<vtkIdType, BlockAttributes::Color>> Colors;
+  std::vector<BlockBVH::Bounds> Bounds;
+
+  // Serializes the partitions of `meshes` and the members above. Partitions
+  // that are not polydata, and arrays that are not stored contiguously, are
+  // left out.
+  void Write(vtkPartitionedDataSetCollection *meshes,
+             std::vector<char> &out) const;
+  // Fills `meshes` and the members from a snapshot. The arrays of the
+  // partitions point into `data`. Returns false and describes the problem in
+  // `error` when `data` is not a snapshot of this version.
+  bool Read(char *data, std::size_t size,
+            vtkPartitionedDataSetCollection *meshes, std::string &error);
+};
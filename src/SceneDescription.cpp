@@ -0,0 +1,238 @@
+#include "SceneDescription.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace {
+std::uint64_t SplitMix64(std::uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+// Uniform in [0, 1). Unlike the standard distributions, the sequence is the
+// same with every standard library, so a scene file gives the same workload
+// everywhere.
+double UniformRandom(std::uint32_t seed, long long instance, int axis) {
+  const std::uint64_t hash = SplitMix64(
+      SplitMix64(seed) + 3 * static_cast<std::uint64_t>(instance) + axis);
+  return static_cast<double>(hash >> 11) / 9007199254740992.0; // 2^53
+}
+
+bool ParsePrimitive(const std::string &name,
+                    SceneDescription::Primitive &primitive) {
+  for (int i = SceneDescription::Cone; i <= SceneDescription::Cylinder; ++i) {
+    const auto candidate = SceneDescription::Primitive(i);
+    if (name == SceneDescription::GetPrimitiveName(candidate)) {
+      primitive = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+// True when every value of the line was read and nothing is left.
+bool IsComplete(std::istringstream &line) {
+  std::string extra;
+  return !line.fail() && !(line >> extra);
+}
+} // namespace
+
+SceneDescription SceneDescription::MakeGrid(int nx, int ny) {
+  SceneDescription scene;
+  scene.gridSize = {nx, ny, 1};
+  return scene;
+}
+
+bool SceneDescription::Parse(const std::string &text, SceneDescription &scene,
+                             std::string &error) {
+  SceneDescription parsed;
+  std::istringstream lines(text);
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(lines, line)) {
+    ++lineNumber;
+    line = line.substr(0, line.find('#'));
+    std::istringstream tokens(line);
+    std::string key;
+    if (!(tokens >> key)) {
+      continue;
+    }
+    bool valid = false;
+    if (key == "name") {
+      tokens >> parsed.name;
+      valid = IsComplete(tokens);
+    } else if (key == "layout") {
+      std::string layout;
+      tokens >> layout;
+      valid = IsComplete(tokens) && (layout == "grid" || layout == "random");
+      parsed.layout = layout == "random" ? Random : Grid;
+    } else if (key == "grid") {
+      tokens >> parsed.gridSize[0] >> parsed.gridSize[1];
+      parsed.gridSize[2] = 1;
+      // nz is optional.
+      if (!tokens.fail() && !(tokens >> std::ws).eof()) {
+        tokens >> parsed.gridSize[2];
+      }
+      valid = IsComplete(tokens) && parsed.gridSize[0] > 0 &&
+              parsed.gridSize[1] > 0 && parsed.gridSize[2] > 0;
+    } else if (key == "count") {
+      tokens >> parsed.count;
+      valid = IsComplete(tokens) && parsed.count > 0;
+    } else if (key == "seed") {
+      tokens >> parsed.seed;
+      valid = IsComplete(tokens);
+    } else if (key == "extent") {
+      tokens >> parsed.extent[0] >> parsed.extent[1] >> parsed.extent[2];
+      valid = IsComplete(tokens) && parsed.extent[0] >= 0 &&
+              parsed.extent[1] >= 0 && parsed.extent[2] >= 0;
+    } else if (key == "spacing") {
+      tokens >> parsed.spacing[0] >> parsed.spacing[1] >> parsed.spacing[2];
+      // the cones and cylinders are 2 units shorter than the Y spacing.
+      valid = IsComplete(tokens) && parsed.spacing[0] > 0 &&
+              parsed.spacing[1] > 2 && parsed.spacing[2] > 0;
+    } else if (key == "resolution") {
+      tokens >> parsed.resolution;
+      valid = IsComplete(tokens) && parsed.resolution >= 3;
+    } else if (key == "layers") {
+      std::string names[NumLayers];
+      tokens >> names[0] >> names[1] >> names[2];
+      valid = IsComplete(tokens);
+      for (int layer = 0; valid && layer < NumLayers; ++layer) {
+        valid = ParsePrimitive(names[layer], parsed.layers[layer]);
+      }
+    } else if (key == "color") {
+      BlockRange range;
+      tokens >> range.begin >> range.end >> range.color[0] >> range.color[1] >>
+          range.color[2];
+      valid = IsComplete(tokens) && range.begin <= range.end &&
+              std::all_of(range.color.begin(), range.color.end(),
+                          [](double c) { return c >= 0 && c <= 1; });
+      parsed.blocks.push_back(range);
+    } else if (key == "hide") {
+      BlockRange range;
+      range.hide = true;
+      tokens >> range.begin >> range.end;
+      valid = IsComplete(tokens) && range.begin <= range.end;
+      parsed.blocks.push_back(range);
+    }
+    if (!valid) {
+      error = "line " + std::to_string(lineNumber) + ": invalid '" + key + "'";
+      return false;
+    }
+  }
+  if (parsed.layout == Random && parsed.count == 0) {
+    error = "the random layout needs a count";
+    return false;
+  }
+  // block ids are ints in the bindings.
+  const long long numInstances = parsed.GetNumberOfInstances();
+  if (numInstances > std::numeric_limits<int>::max() / NumLayers) {
+    error = "too many instances (" + std::to_string(numInstances) + ")";
+    return false;
+  }
+  scene = std::move(parsed);
+  return true;
+}
+
+bool SceneDescription::ReadFile(const std::string &filename,
+                                SceneDescription &scene, std::string &error) {
+  std::ifstream file(filename);
+  if (!file) {
+    error = "cannot open " + filename;
+    return false;
+  }
+  std::stringstream text;
+  text << file.rdbuf();
+  return Parse(text.str(), scene, error);
+}
+
+std::string SceneDescription::ToString() const {
+  std::ostringstream out;
+  out.precision(std::numeric_limits<double>::max_digits10);
+  out << "name " << this->name << '\n';
+  out << "layout " << (this->layout == Random ? "random" : "grid") << '\n';
+  out << "grid " << this->gridSize[0] << ' ' << this->gridSize[1] << ' '
+      << this->gridSize[2] << '\n';
+  if (this->count > 0) {
+    out << "count " << this->count << '\n';
+  }
+  out << "seed " << this->seed << '\n';
+  out << "extent " << this->extent[0] << ' ' << this->extent[1] << ' '
+      << this->extent[2] << '\n';
+  out << "spacing " << this->spacing[0] << ' ' << this->spacing[1] << ' '
+      << this->spacing[2] << '\n';
+  out << "resolution " << this->resolution << '\n';
+  out << "layers";
+  for (const auto &primitive : this->layers) {
+    out << ' ' << GetPrimitiveName(primitive);
+  }
+  out << '\n';
+  for (const auto &range : this->blocks) {
+    if (range.hide) {
+      out << "hide " << range.begin << ' ' << range.end << '\n';
+    } else {
+      out << "color " << range.begin << ' ' << range.end << ' '
+          << range.color[0] << ' ' << range.color[1] << ' ' << range.color[2]
+          << '\n';
+    }
+  }
+  return out.str();
+}
+
+long long SceneDescription::GetNumberOfInstances() const {
+  if (this->layout == Random) {
+    return this->count;
+  }
+  return static_cast<long long>(this->gridSize[0]) * this->gridSize[1] *
+         this->gridSize[2];
+}
+
+int SceneDescription::GetResolution(int level) const {
+  return std::max(this->resolution >> level, 3);
+}
+
+void SceneDescription::ComputeCenters(int layer, long long begin,
+                                      long long end, float *xyz) const {
+  if (this->layout == Grid) {
+    const long long ny = this->gridSize[1], nz = this->gridSize[2];
+    for (long long id = begin; id < end; ++id) {
+      const long long i = id / (ny * nz), j = (id / nz) % ny, k = id % nz;
+      xyz[3 * id] = static_cast<float>(i * this->spacing[0]);
+      xyz[3 * id + 1] = static_cast<float>(j * this->spacing[1]);
+      xyz[3 * id + 2] =
+          static_cast<float>((k * NumLayers + layer) * this->spacing[2]);
+    }
+    return;
+  }
+  // without an extent, the instances are spread over a square as large as
+  // the grid with the same number of instances.
+  const double side = std::ceil(std::sqrt(static_cast<double>(this->count)));
+  const double extent[3] = {
+      this->extent[0] > 0 ? this->extent[0] : side * this->spacing[0],
+      this->extent[1] > 0 ? this->extent[1] : side * this->spacing[1],
+      this->extent[2]};
+  // every layer gets the same positions, stacked like in the grid.
+  for (long long id = begin; id < end; ++id) {
+    for (int axis = 0; axis < 3; ++axis) {
+      xyz[3 * id + axis] = static_cast<float>(
+          UniformRandom(this->seed, id, axis) * extent[axis]);
+    }
+    xyz[3 * id + 2] += static_cast<float>(layer * this->spacing[2]);
+  }
+}
+
+const char *SceneDescription::GetPrimitiveName(Primitive primitive) {
+  switch (primitive) {
+  case Cone:
+    return "cone";
+  case Sphere:
+    return "sphere";
+  default:
+    return "cylinder";
+  }
+}
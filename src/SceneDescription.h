@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Workload generated by BenchmarkApp::CreateScene. Every instance holds one
+// block per layer, the layers are stacked along Z. The block id of layer `l`
+// of instance `i` is `i * NumLayers + l`.
+//
+// Text format, one setting per line, `#` starts a comment:
+//   name <single word>
+//   layout grid|random
+//   grid <nx> <ny> [nz]          instances of the grid layout
+//   count <instances>            instances of the random layout
+//   seed <unsigned integer>      random layout
+//   extent <x> <y> <z>           box of the random layout, 0: from the count
+//   spacing <x> <y> <z>          grid step, also sizes the primitives
+//   resolution <n>               finest tessellation, halved at every level
+//   layers <p0> <p1> <p2>        cone, sphere or cylinder for every layer
+//   color <begin> <end> <r> <g> <b>   color of the block ids [begin, end),
+//                                     components from 0 to 1
+//   hide <begin> <end>           hides the block ids [begin, end)
+struct SceneDescription {
+  static constexpr int NumLayers = 3;
+  enum Layout { Grid = 0, Random };
+  enum Primitive { Cone = 0, Sphere, Cylinder };
+  // Applied in order after the blocks are created, like the block batch
+  // updates of BenchmarkApp.
+  struct BlockRange {
+    long long begin = 0;
+    long long end = 0;
+    bool hide = false;
+    std::array<double, 3> color = {1, 1, 1}; // only without hide.
+  };
+
+  std::string name = "grid";
+  Layout layout = Grid;
+  std::array<int, 3> gridSize = {32, 32, 1};
+  long long count = 0;
+  std::uint32_t seed = 1;
+  std::array<double, 3> extent = {0, 0, 0};
+  std::array<double, 3> spacing = {50, 50, 50};
+  int resolution = 16;
+  std::array<Primitive, NumLayers> layers = {Cone, Sphere, Cylinder};
+  std::vector<BlockRange> blocks;
+
+  // The nx * ny grid of earlier versions.
+  static SceneDescription MakeGrid(int nx, int ny);
+  // Returns false and describes the first invalid line in `error`. `scene` is
+  // left untouched then.
+  static bool Parse(const std::string &text, SceneDescription &scene,
+                    std::string &error);
+  static bool ReadFile(const std::string &filename, SceneDescription &scene,
+                       std::string &error);
+  // Text that parses back into the same scene.
+  std::string ToString() const;
+
+  long long GetNumberOfInstances() const;
+  // Tessellation of the given level of detail, at least 3.
+  int GetResolution(int level) const;
+  // Writes the centers of the instances [begin, end) of a layer to `xyz`,
+  // three floats per instance starting at instance `begin`. The random layout
+  // only depends on the seed and the instance, so ranges can be filled in
+  // parallel.
+  void ComputeCenters(int layer, long long begin, long long end,
+                      float *xyz) const;
+
+  static const char *GetPrimitiveName(Primitive primitive);
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Order statistics over a set of samples (frame times, pick latencies ..)
+struct SummaryStatistics {
+  std::size_t count = 0;
+  double min = 0;
+  double max = 0;
+  double mean = 0;
+  double p50 = 0;
+  double p95 = 0;
+  double p99 = 0;
+
+  // Samples are taken by value because they need to be sorted.
+  static SummaryStatistics Compute(std::vector<double> samples) {
+    SummaryStatistics stats;
+    stats.count = samples.size();
+    if (samples.empty()) {
+      return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (const auto &sample : samples) {
+      sum += sample;
+    }
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.mean = sum / samples.size();
+    stats.p50 = Percentile(samples, 50);
+    stats.p95 = Percentile(samples, 95);
+    stats.p99 = Percentile(samples, 99);
+    return stats;
+  }
+
+  // Nearest-rank percentile of already sorted samples.
+  static double Percentile(const std::vector<double> &sorted, double pct) {
+    if (sorted.empty()) {
+      return 0;
+    }
+    const auto rank =
+        static_cast<std::size_t>(std::ceil(pct / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+  }
+};
@@ -0,0 +1,74 @@
+#include "TranslucencyPass.h"
+
+#include <vtkObjectFactory.h>
+#include <vtkProp.h>
+#include <vtkRenderState.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+
+#include <chrono>
+
+vtkStandardNewMacro(TranslucencyPass);
+
+TranslucencyPass::TranslucencyPass() {
+  this->Peeling->SetTranslucentPass(this->Translucent);
+  // peel until the limit or until no pixel changes, so that the peel count
+  // alone sets the cost.
+  this->Peeling->SetOcclusionRatio(0.0);
+  this->Peeling->SetMaximumNumberOfPeels(4);
+  this->Blending->SetTranslucentPass(this->Translucent);
+}
+
+TranslucencyPass::~TranslucencyPass() = default;
+
+void TranslucencyPass::SetMaximumNumberOfPeels(int peels) {
+  this->Peeling->SetMaximumNumberOfPeels(peels);
+  this->Modified();
+}
+
+void TranslucencyPass::Render(const vtkRenderState *s) {
+  this->NumberOfRenderedProps = 0;
+  bool translucent = false;
+  for (int i = 0; i < s->GetPropArrayCount() && !translucent; ++i) {
+    translucent = s->GetPropArray()[i]->HasTranslucentPolygonalGeometry() != 0;
+  }
+  if (!translucent) {
+    return;
+  }
+  auto ren = s->GetRenderer();
+  if (ren->GetSelector() != nullptr) {
+    // the selection buffers hold ids, there is nothing to blend.
+    this->Translucent->Render(s);
+    this->NumberOfRenderedProps = this->Translucent->GetNumberOfRenderedProps();
+    return;
+  }
+  vtkRenderPass *pass = this->Peeling;
+  if (this->Technique == OrderIndependent) {
+    pass = this->Blending;
+  }
+  auto window = ren->GetRenderWindow();
+  if (this->WaitForCompletion) {
+    window->WaitForCompletion();
+  }
+  const auto startTime = std::chrono::steady_clock::now();
+  pass->Render(s);
+  if (this->WaitForCompletion) {
+    window->WaitForCompletion();
+  }
+  this->ElapsedTime += std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - startTime)
+                           .count();
+  this->NumberOfRenderedProps = pass->GetNumberOfRenderedProps();
+}
+
+void TranslucencyPass::ReleaseGraphicsResources(vtkWindow *w) {
+  this->Translucent->ReleaseGraphicsResources(w);
+  this->Peeling->ReleaseGraphicsResources(w);
+  this->Blending->ReleaseGraphicsResources(w);
+}
+
+double TranslucencyPass::PopElapsedTime() {
+  const double elapsed = this->ElapsedTime;
+  this->ElapsedTime = 0;
+  return elapsed;
+}
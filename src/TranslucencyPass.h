@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vtkDualDepthPeelingPass.h>
+#include <vtkNew.h>
+#include <vtkOrderIndependentTranslucentPass.h>
+#include <vtkRenderPass.h>
+#include <vtkTranslucentPass.h>
+
+// Translucent pass of a vtkRenderStepsPass that renders the translucent
+// geometry with dual depth peeling or weighted blended order independent
+// transparency, and measures it. The GPU work queued by the previous passes is
+// finished before the pass starts and the pass is finished before it returns,
+// so the time covers the translucent geometry alone, unless the waits are
+// turned off. Frames without translucent geometry skip them. Hardware selection
+// renders the translucent geometry in a single plain pass.
+class TranslucencyPass : public vtkRenderPass {
+public:
+  enum Technique { DepthPeeling = 0, OrderIndependent };
+
+  static TranslucencyPass *New();
+  vtkTypeMacro(TranslucencyPass, vtkRenderPass);
+
+  vtkSetMacro(Technique, int);
+  vtkGetMacro(Technique, int);
+  // Upper bound of the peels of depth peeling, 0 peels until every layer is
+  // drawn.
+  void SetMaximumNumberOfPeels(int peels);
+  // Off: the time only covers submitting the pass, the GPU is not waited
+  // for.
+  vtkSetMacro(WaitForCompletion, bool);
+  vtkGetMacro(WaitForCompletion, bool);
+
+  void Render(const vtkRenderState *s) override;
+  void ReleaseGraphicsResources(vtkWindow *w) override;
+
+  // Time spent in the pass since the last call, in milliseconds.
+  double PopElapsedTime();
+
+protected:
+  TranslucencyPass();
+  ~TranslucencyPass() override;
+
+private:
+  int Technique = DepthPeeling;
+  double ElapsedTime = 0;
+  bool WaitForCompletion = true;
+  vtkNew<vtkTranslucentPass> Translucent;
+  vtkNew<vtkDualDepthPeelingPass> Peeling;
+  vtkNew<vtkOrderIndependentTranslucentPass> Blending;
+};
@@ -2,9 +2,12 @@
 // This main function lets you run the benchmark as a native desktop
 // application.
 #include "App.h"
+#include "BenchmarkRunner.h"
 
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 int main(int argc, char *argv[]) {
@@ -12,6 +15,20 @@ int main(int argc, char *argv[]) {
   int nx = 32, ny = 32;
   int lw = 1, ps = 1;     // lineWidth, pointSize;
   int representation = 3; // Surface with edges.
+  int views = 1;
+  auto strategy = BenchmarkApp::RenderStrategy::Composite;
+  bool benchmark = false, softwareGL = false, memoryStats = false;
+  bool levelOfDetail = true;
+  bool frustumCulling = true;
+  bool interactionQuality = true;
+  double interactionBudget = 1000.0 / 30.0;
+  double constructionBudget = 0;
+  double opacity = 1;
+  int peels = 4;
+  auto translucency = BenchmarkApp::TranslucencyTechnique::DepthPeeling;
+  auto areaPicker = BenchmarkApp::AreaPicker::HardwareSelector;
+  std::string filename, sceneFilename, cacheFilename, recordFilename;
+  BenchmarkRunner runner;
 
   for (int i = 1; i < argc; ++i) {
     if (std::string(argv[i]) == "-nx") {
@@ -28,6 +45,91 @@ int main(int argc, char *argv[]) {
       pickType = BenchmarkApp::PickType::Area;
     } else if (std::string(argv[i]) == "--hover-preselect") {
       pickType = BenchmarkApp::PickType::Hover;
+    } else if (std::string(argv[i]) == "--render-strategy") {
+      const std::string name = argv[i + 1];
+      strategy = BenchmarkApp::RenderStrategy::Composite;
+      if (name == "instanced") {
+        strategy = BenchmarkApp::RenderStrategy::Instanced;
+      } else if (name == "merged") {
+        strategy = BenchmarkApp::RenderStrategy::Merged;
+      }
+    } else if (std::string(argv[i]) == "--area-picker") {
+      areaPicker = std::string(argv[i + 1]) == "bvh"
+                       ? BenchmarkApp::AreaPicker::BoundingVolumeHierarchy
+                       : BenchmarkApp::AreaPicker::HardwareSelector;
+    } else if (std::string(argv[i]) == "--file") {
+      filename = argv[i + 1];
+    } else if (std::string(argv[i]) == "--scene") {
+      sceneFilename = argv[i + 1];
+    } else if (std::string(argv[i]) == "--cache") {
+      cacheFilename = argv[i + 1];
+    } else if (std::string(argv[i]) == "--views") {
+      views = std::atoi(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--lod") {
+      levelOfDetail = std::string(argv[i + 1]) != "off";
+    } else if (std::string(argv[i]) == "--culling") {
+      frustumCulling = std::string(argv[i + 1]) != "off";
+    } else if (std::string(argv[i]) == "--interaction-quality") {
+      interactionQuality = std::string(argv[i + 1]) != "off";
+    } else if (std::string(argv[i]) == "--interaction-budget") {
+      interactionBudget = std::atof(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--opacity") {
+      opacity = std::atof(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--translucency") {
+      const std::string name = argv[i + 1];
+      if (name == "peeling") {
+        translucency = BenchmarkApp::TranslucencyTechnique::DepthPeeling;
+      } else if (name == "oit") {
+        translucency = BenchmarkApp::TranslucencyTechnique::OrderIndependent;
+      } else {
+        std::cerr << "Invalid translucency technique " << name << std::endl;
+      }
+    } else if (std::string(argv[i]) == "--peels") {
+      peels = std::atoi(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--construction-budget") {
+      constructionBudget = std::atof(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--memory-stats") {
+      memoryStats = true;
+    } else if (std::string(argv[i]) == "--benchmark") {
+      benchmark = true;
+    } else if (std::string(argv[i]) == "--software-gl") {
+      softwareGL = true;
+    } else if (std::string(argv[i]) == "--frames") {
+      runner.NumberOfFrames = std::atoi(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--grid-sizes") {
+      runner.GridSizes = BenchmarkRunner::ParseGridSizes(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--scenes") {
+      runner.Scenes = BenchmarkRunner::ParseSceneFiles(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--representations") {
+      runner.Representations =
+          BenchmarkRunner::ParseRepresentations(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--view-counts") {
+      runner.ViewCounts = BenchmarkRunner::ParseViewCounts(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--translucency-techniques") {
+      runner.TranslucencyTechniques =
+          BenchmarkRunner::ParseTranslucencyTechniques(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--pick-types") {
+      runner.PickTypes = BenchmarkRunner::ParsePickTypes(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--render-strategies") {
+      runner.RenderStrategies =
+          BenchmarkRunner::ParseRenderStrategies(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--area-pickers") {
+      runner.AreaPickers = BenchmarkRunner::ParseAreaPickers(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--record") {
+      recordFilename = argv[i + 1];
+    } else if (std::string(argv[i]) == "--replay") {
+      std::ifstream file(argv[i + 1]);
+      std::stringstream text;
+      text << file.rdbuf();
+      runner.Replay = text.str();
+      if (runner.Replay.empty()) {
+        std::cerr << "Cannot read " << argv[i + 1] << std::endl;
+        return 1;
+      }
+    } else if (std::string(argv[i]) == "--replay-timestep") {
+      runner.ReplayTimestep = std::atof(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--report") {
+      runner.ReportFileName = argv[i + 1];
     } else if (std::string(argv[i]) == "--help" ||
                std::string(argv[i]) == "-h") {
       std::cout
@@ -41,22 +143,128 @@ int main(int argc, char *argv[]) {
           << "\t-ps <point size> \n"
           << "\t--area-pick [Enables area picker. \'r\' toggles rubberband]\n"
           << "\t--hover-preselect [Highlights a mesh when mouse hovers above "
-             "it]"
+             "it]\n"
+          << "\t--render-strategy <composite, instanced or merged> \n"
+          << "\t--area-picker <hardware or bvh> \n"
+          << "\t--file <vtp, vtm, stl or obj file rendered instead of the "
+             "grid> \n"
+          << "\t--scene <scene description file generated instead of the "
+             "grid> \n"
+          << "\t--cache <scene cache file, read instead of building the "
+             "scene when valid, written after building it otherwise> \n"
+          << "\t--views <1 to 4> [Splits the window into views of the same "
+             "scene]\n"
+          << "\t--lod <on or off> [Tessellates blocks by their size on screen]\n"
+          << "\t--culling <on or off> [Skips blocks outside of the view]\n"
+          << "\t--interaction-quality <on or off> [Lowers the quality while "
+             "the camera moves]\n"
+          << "\t--interaction-budget <ms per frame above which moving frames "
+             "use the coarsest level, default 33.3> \n"
+          << "\t--opacity <opacity of every layer, below 1 draws the "
+             "blocks translucent> \n"
+          << "\t--translucency <peeling or oit> [Depth peeling or single "
+             "pass order independent transparency]\n"
+          << "\t--peels <peel limit of depth peeling, default 4> \n"
+          << "\t--construction-budget <ms per frame spent building the "
+             "scene, 0 builds it at once> \n"
+          << "\t--memory-stats [Prints heap, dataset and GPU buffer memory "
+             "after loading and on exit]\n"
+          << "\t--benchmark [Renders offscreen without user interaction and "
+             "writes a report]\n"
+          << "\t--software-gl [Requests a software OpenGL context]\n"
+          << "\t--frames <number of frames in the camera orbit> \n"
+          << "\t--grid-sizes <comma separated list, ex: 8x8,32x32,128x128> \n"
+          << "\t--scenes <comma separated list of scene description files, "
+             "replaces the grid sizes> \n"
+          << "\t--representations <comma separated list, ex: 0,1,2,3> \n"
+          << "\t--view-counts <comma separated list, ex: 1,2,4> \n"
+          << "\t--translucency-techniques <comma separated list of "
+             "peeling,oit> \n"
+          << "\t--pick-types <comma separated list of none,area,hover> \n"
+          << "\t--render-strategies <comma separated list of "
+             "composite,instanced,merged> \n"
+          << "\t--area-pickers <comma separated list of hardware,bvh> \n"
+          << "\t--record <file the input of the session is written to on "
+             "exit> \n"
+          << "\t--replay <recorded input played instead of the camera orbit, "
+             "one frame per step> \n"
+          << "\t--replay-timestep <ms of recorded input per frame, default "
+             "16.667> \n"
+          << "\t--report <output file, .json or .csv>"
           << std::endl;
       return 0;
     }
   }
 
+  if (softwareGL) {
+    // must be set before the OpenGL context is created.
+#ifndef _WIN32
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+    setenv("GALLIUM_DRIVER", "llvmpipe", 0);
+    setenv("VTK_DEFAULT_OPENGL_WINDOW", "vtkOSOpenGLRenderWindow", 0);
+#endif
+  }
+
   BenchmarkApp app;
   app.Initialize();
-  app.CreateDatasets(nx, ny);
+  app.SetRenderStrategy(strategy);
+  app.SetLevelOfDetail(levelOfDetail);
+  app.SetFrustumCulling(frustumCulling);
+  app.SetInteractionQuality(interactionQuality);
+  app.SetInteractionFrameBudget(interactionBudget);
+  app.SetTranslucencyTechnique(translucency);
+  app.SetMaximumNumberOfPeels(peels);
+  if (benchmark) {
+    app.SetSelectedBlockColor(0.952, 0.937, 0.368);
+    app.SetScrollSensitivity(1);
+    app.SetEdgeColor(0.8, 0.8, 0.8);
+    runner.LineWidth = lw;
+    runner.PointSize = ps;
+    runner.Opacity = opacity;
+    runner.MaximumNumberOfPeels = peels;
+    return runner.Run(app);
+  }
+  // a valid cache replaces the file, the scene or the grid.
+  if (cacheFilename.empty() || app.LoadSceneCache(cacheFilename) == 0) {
+    // the cache is written from the complete scene.
+    app.SetConstructionBudget(cacheFilename.empty() ? constructionBudget : 0);
+    if (!filename.empty()) {
+      app.LoadFile(filename);
+    } else if (!sceneFilename.empty()) {
+      app.LoadSceneFile(sceneFilename);
+    } else {
+      app.CreateDatasets(nx, ny);
+    }
+    if (!cacheFilename.empty()) {
+      app.SaveSceneCache(cacheFilename);
+    }
+  }
+  app.SetConstructionBudget(constructionBudget);
   app.SetSelectedBlockColor(0.952, 0.937, 0.368);
   app.SetPickType(pickType);
+  app.SetAreaPicker(areaPicker);
   app.SetScrollSensitivity(1);
   app.SetLineWidth(lw);
   app.SetPointSize(ps);
   app.SetRepresentation(representation);
   app.SetEdgeColor(0.8, 0.8, 0.8);
-  return app.Run();
+  app.SetNumberOfViews(views);
+  for (int layer = 0; layer < BenchmarkApp::NumLayers; ++layer) {
+    app.SetLayerOpacity(BenchmarkApp::LayerID(layer), opacity);
+  }
+  if (memoryStats) {
+    app.PrintMemoryStats();
+  }
+  if (!recordFilename.empty()) {
+    app.StartRecording();
+  }
+  const int status = app.Run();
+  if (!recordFilename.empty()) {
+    std::ofstream(recordFilename) << app.StopRecording();
+  }
+  if (memoryStats) {
+    app.PrintMemoryStats();
+  }
+  return status;
 }
 #endif
@@ -1,41 +1,5 @@
 import css from '../styles/app.module.css';
-
-let primMap = {};
-let primCounts = [0, 0, 0];
-primMap[WebGL2RenderingContext.POINTS] = { ndx: 0, fn: count => count, };
-primMap[WebGL2RenderingContext.LINE_LOOP] = { ndx: 1, fn: count => count, };
-primMap[WebGL2RenderingContext.LINE_STRIP] = { ndx: 1, fn: count => count - 1, };
-primMap[WebGL2RenderingContext.LINES] = { ndx: 1, fn: count => count / 2 | 0, };
-primMap[WebGL2RenderingContext.TRIANGLE_STRIP] = { ndx: 2, fn: count => count - 2, };
-primMap[WebGL2RenderingContext.TRIANGLE_FAN] = { ndx: 2, fn: count => count - 2, };
-primMap[WebGL2RenderingContext.TRIANGLES] = { ndx: 2, fn: count => count / 3 | 0, };
-
-function addCount(ctx, type, count) {
-  // todo: associate primitive counts with a ctx.
-  const primInfo = primMap[type];
-  primCounts[primInfo.ndx] += primInfo.fn(count);
-}
-
-WebGL2RenderingContext.prototype.drawArrays = (function (oldFn) {
-  return function (type, offset, count) {
-    addCount(this, type, count);
-    oldFn.call(this, type, offset, count);
-  };
-}(WebGL2RenderingContext.prototype.drawArrays));
-
-WebGL2RenderingContext.prototype.drawArraysInstanced = (function (oldFn) {
-  return function (type, first, count, instanceCount) {
-    addCount(this, type, count * instanceCount);
-    oldFn.call(this, type, first, count, instanceCount);
-  };
-}(WebGL2RenderingContext.prototype.drawArraysInstanced));
-
-WebGL2RenderingContext.prototype.drawElements = (function (oldFn) {
-  return function (type, count, indexType, offset) {
-    addCount(this, type, count);
-    oldFn.call(this, type, count, indexType, offset);
-  };
-}(WebGL2RenderingContext.prototype.drawElements));
+import { takePrimitiveCounts } from './primitives';
 
 const times = [];
 const framesWindow = 1000; // ms
@@ -45,6 +9,35 @@ const glMetricsContainer = document.getElementById('glmetrics');
 glMetricsContainer.setAttribute('class', css.glMetricsPanel);
 const elem = document.getElementById('info');
 let numObjects = 0;
+// returns { p50, p95, p99 } of the frame times recorded in C++.
+let frameStatistics = null;
+// returns the memory use in bytes, refreshed once per frames window.
+let memoryStats = null;
+let memoryText = '';
+let memoryUpdateTime = 0;
+// returns { culled, milliseconds } of the last frame.
+let cullingStats = null;
+// returns { renders, requests, coalesced, skipped } since startup.
+let renderStats = null;
+// returns [{ p50, p95, p99 }] of the render time of every view.
+let viewStatistics = null;
+// returns { counts, binWidth } of the frame times, binWidth in ms.
+let frameHistogram = null;
+const histogramBars = '▁▂▃▄▅▆▇█';
+// returns { p50, p95, p99 } of the time spent in the translucent passes.
+let translucencyStatistics = null;
+// returns the qualities of the recent frames oldest first, 0 is full.
+let frameQualities = null;
+const qualityNames = ['full', 'reduced', 'coarse'];
+// returns [{ name, milliseconds }] of the startup phases reached so far.
+let startupTimes = null;
+// returns { progress, frameTime }, the fraction of the scene built so far and
+// the mean frame time in ms while it is built.
+let constructionStats = null;
+// returns the [points, lines, triangles] drawn since the last tick.
+let primitiveCounts = takePrimitiveCounts;
+// build variant of the wasm module.
+let threadingText = '';
 
 // this function is called after vtkRenderWindow finishes rendering from C++
 function tick(now) {
@@ -55,14 +48,74 @@ function tick(now) {
   times.push(now);
   fps = times.length;
 
+  let frameTimes = '';
+  if (frameStatistics) {
+    const stats = frameStatistics();
+    frameTimes = `\n${stats.p50.toFixed(1)}/${stats.p95.toFixed(1)}/${stats.p99.toFixed(1)} ms (p50/p95/p99)`;
+  }
+  if (frameHistogram) {
+    const { counts, binWidth } = frameHistogram();
+    const most = Math.max(1, ...counts);
+    const bars = counts.map(count => histogramBars[Math.round((histogramBars.length - 1) * count / most)]);
+    frameTimes += `\n${bars.join('')} 0-${(binWidth * counts.length).toFixed(1)} ms`;
+  }
+  if (viewStatistics) {
+    const views = viewStatistics();
+    if (views.length > 1) {
+      frameTimes += `\n${views.map(stats => stats.p95.toFixed(1)).join('/')} ms per view (p95)`;
+    }
+  }
+  if (translucencyStatistics) {
+    const stats = translucencyStatistics();
+    if (stats.p95 > 0) {
+      frameTimes += `\n${stats.p50.toFixed(1)}/${stats.p95.toFixed(1)} ms translucency (p50/p95)`;
+    }
+  }
+  if (memoryStats && now - memoryUpdateTime >= framesWindow) {
+    const stats = memoryStats();
+    const mib = bytes => (bytes / (1024 * 1024)).toFixed(1);
+    memoryText = `\n${mib(stats.heapUsed)}/${mib(stats.heapSize)} MiB heap (peak ${mib(stats.heapHighWaterMark)})
+${mib(stats.gpuBuffers)} MiB GPU buffers (est.)`;
+    memoryUpdateTime = now;
+  }
+  let cullingText = '';
+  if (cullingStats) {
+    const stats = cullingStats();
+    cullingText = `\n${stats.culled} culled in ${stats.milliseconds.toFixed(2)} ms`;
+  }
+  let renderText = '';
+  if (renderStats) {
+    const stats = renderStats();
+    renderText = `\n${stats.renders} renders for ${stats.requests} requests (${stats.coalesced} coalesced, ${stats.skipped} skipped)`;
+  }
+  let qualityText = '';
+  if (frameQualities) {
+    const qualities = frameQualities();
+    if (qualities.length > 0) {
+      const counts = [0, 0, 0];
+      qualities.forEach(quality => ++counts[quality]);
+      qualityText = `\n${qualityNames[qualities[qualities.length - 1]]} quality (${counts.join('/')} full/reduced/coarse)`;
+    }
+  }
+  let startupText = '';
+  if (startupTimes) {
+    const phases = startupTimes();
+    startupText = phases.map(phase => `\n${phase.milliseconds.toFixed(0)} ms ${phase.name}`).join('');
+  }
+  let constructionText = '';
+  if (constructionStats) {
+    const { progress, frameTime } = constructionStats();
+    if (progress < 1) {
+      constructionText = `\nbuilding scene ${(100 * progress).toFixed(0)}%, ${frameTime.toFixed(1)} ms per frame`;
+    }
+  }
+  const primCounts = primitiveCounts();
   elem.textContent = 
-`${fps.toFixed(1)} fps
+`${fps.toFixed(1)} fps${constructionText}${frameTimes}${qualityText}${memoryText}${cullingText}${renderText}${threadingText}${startupText}
 ${numObjects} objects
 ${primCounts[2]} triangles
 ${primCounts[1]} lines
 ${primCounts[0]} points`;
-
-  primCounts = [0, 0, 0];
 }
 
 function setNumberOfObjects(num) {
@@ -70,4 +123,67 @@ function setNumberOfObjects(num) {
   // html text updated on next tick.
 }
 
-export { setNumberOfObjects, tick };
+function setFrameStatisticsProvider(provider) {
+  frameStatistics = provider;
+}
+
+function setMemoryStatsProvider(provider) {
+  memoryStats = provider;
+}
+
+function setCullingStatsProvider(provider) {
+  cullingStats = provider;
+}
+
+function setRenderStatsProvider(provider) {
+  renderStats = provider;
+}
+
+function setFrameHistogramProvider(provider) {
+  frameHistogram = provider;
+}
+
+function setViewStatisticsProvider(provider) {
+  viewStatistics = provider;
+}
+
+function setTranslucencyStatisticsProvider(provider) {
+  translucencyStatistics = provider;
+}
+
+function setFrameQualityProvider(provider) {
+  frameQualities = provider;
+}
+
+function setStartupTimesProvider(provider) {
+  startupTimes = provider;
+}
+
+function setConstructionStatsProvider(provider) {
+  constructionStats = provider;
+}
+
+function setPrimitiveCountsProvider(provider) {
+  primitiveCounts = provider;
+}
+
+function setThreadingInfo(text) {
+  threadingText = `\n${text}`;
+}
+
+export {
+  setConstructionStatsProvider,
+  setCullingStatsProvider,
+  setFrameHistogramProvider,
+  setFrameQualityProvider,
+  setFrameStatisticsProvider,
+  setMemoryStatsProvider,
+  setNumberOfObjects,
+  setPrimitiveCountsProvider,
+  setRenderStatsProvider,
+  setStartupTimesProvider,
+  setThreadingInfo,
+  setTranslucencyStatisticsProvider,
+  setViewStatisticsProvider,
+  tick,
+};
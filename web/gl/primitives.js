@@ -0,0 +1,49 @@
+// Counts the primitives of the draw calls of every WebGL2 context of this
+// thread. Loaded before the wasm module, in the page or in the render worker.
+let primMap = {};
+let primCounts = [0, 0, 0];
+primMap[WebGL2RenderingContext.POINTS] = { ndx: 0, fn: count => count, };
+primMap[WebGL2RenderingContext.LINE_LOOP] = { ndx: 1, fn: count => count, };
+primMap[WebGL2RenderingContext.LINE_STRIP] = { ndx: 1, fn: count => count - 1, };
+primMap[WebGL2RenderingContext.LINES] = { ndx: 1, fn: count => count / 2 | 0, };
+primMap[WebGL2RenderingContext.TRIANGLE_STRIP] = { ndx: 2, fn: count => count - 2, };
+primMap[WebGL2RenderingContext.TRIANGLE_FAN] = { ndx: 2, fn: count => count - 2, };
+primMap[WebGL2RenderingContext.TRIANGLES] = { ndx: 2, fn: count => count / 3 | 0, };
+
+function addCount(ctx, type, count) {
+  // todo: associate primitive counts with a ctx.
+  const primInfo = primMap[type];
+  primCounts[primInfo.ndx] += primInfo.fn(count);
+}
+
+WebGL2RenderingContext.prototype.drawArrays = (function (oldFn) {
+  return function (type, offset, count) {
+    addCount(this, type, count);
+    oldFn.call(this, type, offset, count);
+  };
+}(WebGL2RenderingContext.prototype.drawArrays));
+
+WebGL2RenderingContext.prototype.drawArraysInstanced = (function (oldFn) {
+  return function (type, first, count, instanceCount) {
+    addCount(this, type, count * instanceCount);
+    oldFn.call(this, type, first, count, instanceCount);
+  };
+}(WebGL2RenderingContext.prototype.drawArraysInstanced));
+
+WebGL2RenderingContext.prototype.drawElements = (function (oldFn) {
+  return function (type, count, indexType, offset) {
+    addCount(this, type, count);
+    oldFn.call(this, type, count, indexType, offset);
+  };
+}(WebGL2RenderingContext.prototype.drawElements));
+
+// Returns the [points, lines, triangles] drawn since the last call.
+function takePrimitiveCounts() {
+  const counts = primCounts;
+  primCounts = [0, 0, 0];
+  return counts;
+}
+
+export {
+  takePrimitiveCounts,
+};
@@ -1,5 +1,7 @@
 import css from './styles/app.module.css';
 import * as glMetrics from './gl/metrics';
+import { collectMetrics, createScene, loadFile, setUseSceneCache } from './session';
+import { startWorkerApp } from './workerApp';
 
 var Module = {
   canvas: (function () {
@@ -18,9 +20,73 @@ var Module = {
   printErr: (text) => { console.log('stderr: ' + text); },
 };
 
+// startup phases of the page in ms since it started loading, the app adds
+// its own ones measured on the same clock.
+const startupTimes = [];
+function markStartup(name) {
+  startupTimes.push({ name, milliseconds: performance.now() });
+}
+markStartup('page script');
+Module.preRun = [() => markStartup('wasm instantiated')];
+Module.onRuntimeInitialized = () => markStartup('runtime initialized');
+
 // -----------------------------------------------------------
 // Helpers
 // -----------------------------------------------------------
+// The multithreaded build is loaded with ?threads in the url. It needs
+// SharedArrayBuffer, which browsers only enable on cross-origin isolated pages.
+// ?startup loads the build linked for a short startup.
+function selectVariant() {
+  const params = new URLSearchParams(window.location.search);
+  if (params.has('startup')) {
+    return 'startup/';
+  }
+  const requested = params.has('threads');
+  if (requested && !window.crossOriginIsolated) {
+    console.warn('Page is not cross-origin isolated, loading the single-threaded build.');
+  }
+  return requested && window.crossOriginIsolated ? 'threads/' : '';
+}
+
+// ?worker renders in a dedicated worker on an OffscreenCanvas, see
+// workerApp.js. The threads of the multithreaded build would be nested
+// workers, it stays on the main thread.
+function selectWorker(variant) {
+  const requested = new URLSearchParams(window.location.search).has('worker');
+  const supported = 'transferControlToOffscreen' in HTMLCanvasElement.prototype;
+  if (requested && (!supported || variant === 'threads/')) {
+    console.warn('Rendering on the main thread, the worker needs OffscreenCanvas and the single-threaded build.');
+  }
+  return requested && supported && variant !== 'threads/';
+}
+
+// Starts downloading and compiling the wasm module while the glue code
+// loads. The workers of the threaded build instantiate it on their own.
+function prefetchModule(variant) {
+  if (variant === 'threads/' || !WebAssembly.instantiateStreaming) {
+    return;
+  }
+  const response = fetch(`${variant}vtkRenderingApplication.wasm`);
+  Module.instantiateWasm = (imports, receiveInstance) => {
+    response.then(res => WebAssembly.instantiateStreaming(res.clone(), imports).catch(error => {
+      // servers that do not send application/wasm cannot stream.
+      console.warn('Streaming compilation failed, compiling the whole module', error);
+      return res.arrayBuffer().then(bytes => WebAssembly.instantiate(bytes, imports));
+    })).then(result => receiveInstance(result.instance, result.module));
+    return {};
+  };
+}
+
+function loadScript(src) {
+  return new Promise((resolve, reject) => {
+    const script = document.createElement('script');
+    script.src = src;
+    script.onload = resolve;
+    script.onerror = () => reject(new Error(`Failed to load ${src}`));
+    document.body.appendChild(script);
+  });
+}
+
 // Converts the HTML color picker value into usable RGB
 function hexToRGB(hex) {
   const result = /^#?([a-f\d]{2})([a-f\d]{2})([a-f\d]{2})$/i.exec(hex);
@@ -40,6 +106,7 @@ let pointSize = 1;
 let layer0Visibility = true; // cones
 let layer1Visibility = true; // spheres
 let layer2Visibility = true; // cylinders
+let levelOfDetail = true;
 let camStates = [null, null, null, null, null]
 let nx = 8;
 let ny = 8;
@@ -83,6 +150,49 @@ const controller = `
       <output>${pointSize}</output>
     </td>
   </tr>
+  <tr>
+    <td>Render strategy</td>
+    <td>
+      <select class='renderStrategy' style="width: 100%">
+        <option value='0' selected>Composite</option>
+        <option value='1'>Instanced</option>
+        <option value='2'>Merged</option>
+      </select>
+    </td>
+  </tr>
+  <tr>
+    <td>Level of detail</td>
+    <td>
+      <input type='checkbox' class='levelOfDetail' checked='${levelOfDetail}'>
+    </td>
+  </tr>
+  <tr>
+    <td>Split views</td>
+    <td>
+      <select class='numberOfViews' style="width: 100%">
+        <option value='1' selected>1</option>
+        <option value='2'>2</option>
+        <option value='3'>3</option>
+        <option value='4'>4</option>
+      </select>
+    </td>
+  </tr>
+  <tr>
+    <td>Opacity</td>
+    <td>
+      <input class='opacity' type='range' min='0' max='100' value='100' oninput='this.nextElementSibling.value = this.value'>
+      <output>100</output>
+    </td>
+  </tr>
+  <tr>
+    <td>Translucency</td>
+    <td>
+      <select class='translucency' style="width: 100%">
+        <option value='0' selected>Depth peeling</option>
+        <option value='1'>Order independent (single pass)</option>
+      </select>
+    </td>
+  </tr>
   <tr>
     <td>Selector type</td>
     <td>
@@ -90,6 +200,7 @@ const controller = `
         <option value='0' selected>Area Picker</option>
         <option value='1'>Hover Pre-select</option>
         <option value='2'>None</option>
+        <option value='3'>Area Picker (CPU BVH)</option>
       </select>
     </td>
     <tr id='selection_color_row' style='display: none;'>
@@ -131,6 +242,12 @@ const controller = `
       <output>${ny}</output>
     </td>
   </tr>
+  <tr>
+    <td>Load file (vtp, stl, obj, scene)</td>
+    <td>
+      <input class='loadFile' type='file' accept='.vtp,.stl,.obj,.scene,.input'>
+    </td>
+  </tr>
 </table>
 <hr>
 <table>
@@ -190,6 +307,9 @@ const controller = `
   <td>
     <button class='clearselectionbutton' style="width: 100%">Clear Selection</button>
   </td>
+  <td>
+    <button class='recordbutton' style="width: 100%">Record Input</button>
+  </td>
 </table>
 </div>`
 controlContainer.innerHTML = controller;
@@ -208,7 +328,7 @@ document
   .addEventListener('change', (e) => {
     const newRepValue = Number(e.target.value);
     app.setRepresentation(newRepValue);
-    app.render();
+    app.requestRender();
     updatePropertyWidgets();
   });
 document
@@ -216,20 +336,64 @@ document
   .addEventListener('input', (e) => {
     lineWidth = Number(e.target.value);
     app.setLineWidth(lineWidth);
-    app.render();
+    app.requestRender();
   });
 document
   .querySelector('.edgeColor').addEventListener('input', (e) => {
     const color = hexToRGB(e.target.value);
     app.setEdgeColor(color.r / 255.0, color.g / 255.0, color.b / 255.0);
-    app.render();
+    app.requestRender();
   });
 document
   .querySelector('.ps')
   .addEventListener('input', (e) => {
     pointSize = Number(e.target.value);
     app.setPointSize(pointSize);
-    app.render();
+    app.requestRender();
+  });
+document
+  .querySelector('.renderStrategy')
+  .addEventListener('change', (e) => {
+    const strategies = [
+      Module.RenderStrategy.Composite,
+      Module.RenderStrategy.Instanced,
+      Module.RenderStrategy.Merged,
+    ];
+    const strategy = strategies[Number(e.target.value)];
+    app.setRenderStrategy(strategy);
+    app.requestRender();
+  });
+document
+  .querySelector('.numberOfViews')
+  .addEventListener('change', (e) => {
+    app.setNumberOfViews(Number(e.target.value));
+    app.requestRender();
+  });
+document
+  .querySelector('.opacity')
+  .addEventListener('input', (e) => {
+    const opacity = Number(e.target.value) / 100;
+    app.setLayerOpacity(Module.LayerID.Cone, opacity);
+    app.setLayerOpacity(Module.LayerID.Sphere, opacity);
+    app.setLayerOpacity(Module.LayerID.Cylinder, opacity);
+    app.requestRender();
+  });
+document
+  .querySelector('.translucency')
+  .addEventListener('change', (e) => {
+    const techniques = [
+      Module.TranslucencyTechnique.DepthPeeling,
+      Module.TranslucencyTechnique.OrderIndependent,
+    ];
+    app.setTranslucencyTechnique(techniques[Number(e.target.value)]);
+    app.requestRender();
+  });
+document
+  .querySelector('.levelOfDetail')
+  .addEventListener('change', (e) => {
+    levelOfDetail = e.target.checked;
+    app.setLevelOfDetail(levelOfDetail);
+    app.requestRender();
   });
 document
   .querySelector('.pickerType')
@@ -246,21 +410,21 @@ document
   .addEventListener('change', () => {
     layer0Visibility = document.querySelector('.layer0Visibility').checked;
     app.setLayerVisibility(Module.LayerID.Cone, layer0Visibility);
-    app.render();
+    app.requestRender();
   });
 document
   .querySelector('.layer1Visibility')
   .addEventListener('change', () => {
     layer1Visibility = document.querySelector('.layer1Visibility').checked;
     app.setLayerVisibility(Module.LayerID.Sphere, layer1Visibility);
-    app.render();
+    app.requestRender();
   });
 document
   .querySelector('.layer2Visibility')
   .addEventListener('change', () => {
     layer2Visibility = document.querySelector('.layer2Visibility').checked;
     app.setLayerVisibility(Module.LayerID.Cylinder, layer2Visibility);
-    app.render();
+    app.requestRender();
   });
 document
   .querySelector('.nx')
@@ -272,66 +436,74 @@ document
   .addEventListener('input', () => {
     updateDatasets();
   });
+document
+  .querySelector('.loadFile')
+  .addEventListener('change', (e) => {
+    if (e.target.files.length > 0) {
+      const file = e.target.files[0];
+      updateScene(() => worker ? app.loadFile(file) : loadFile(Module, app, file));
+    }
+  });
 document
   .querySelector('.camManipulatorVisibility')
   .addEventListener('change', () => {
     let camManipulatorVisibility = document.querySelector('.camManipulatorVisibility').checked;
     app.setShowCameraManipulator(camManipulatorVisibility);
-    app.render();
+    app.requestRender();
   });
 document
   .querySelector('.view1button')
-  .addEventListener('click', () => {
+  .addEventListener('click', async () => {
     if (camStates[0] === null) {
-      camStates[0] = app.getCameraState();
+      camStates[0] = await app.getCameraState();
     }
     else {
       app.setCameraState(camStates[0]);
-      app.render();
+      app.requestRender();
     }
   });
 document
   .querySelector('.view2button')
-  .addEventListener('click', () => {
+  .addEventListener('click', async () => {
     if (camStates[1] === null) {
-      camStates[1] = app.getCameraState();
+      camStates[1] = await app.getCameraState();
     }
     else {
       app.setCameraState(camStates[1]);
-      app.render();
+      app.requestRender();
     }
   });
 document
   .querySelector('.view3button')
-  .addEventListener('click', () => {
+  .addEventListener('click', async () => {
     if (camStates[2] === null) {
-      camStates[2] = app.getCameraState();
+      camStates[2] = await app.getCameraState();
     }
     else {
       app.setCameraState(camStates[2]);
-      app.render();
+      app.requestRender();
     }
   });
 document
   .querySelector('.view4button')
-  .addEventListener('click', () => {
+  .addEventListener('click', async () => {
     if (camStates[3] === null) {
-      camStates[3] = app.getCameraState();
+      camStates[3] = await app.getCameraState();
     }
     else {
       app.setCameraState(camStates[3]);
-      app.render();
+      app.requestRender();
     }
   });
 document
   .querySelector('.view5button')
-  .addEventListener('click', () => {
+  .addEventListener('click', async () => {
     if (camStates[4] === null) {
-      camStates[4] = app.getCameraState();
+      camStates[4] = await app.getCameraState();
     }
     else {
       app.setCameraState(camStates[4]);
-      app.render();
+      app.requestRender();
     }
   });
 document
@@ -363,13 +535,49 @@ document
   .querySelector('.resetviewbutton')
   .addEventListener('click', () => {
     app.resetView();
-    app.render();
+    app.requestRender();
   });
 document
   .querySelector('.clearselectionbutton')
   .addEventListener('click', () => {
     app.clearSelections();
-    app.render();
+    app.requestRender();
+  });
+
+// Generated scenes are stored in the browser once they are built, and
+// restored from there the next time, see session.js. ?nocache in the url
+// always builds them.
+const useSceneCache = !new URLSearchParams(window.location.search).has('nocache');
+setUseSceneCache(useSceneCache);
+
+// The app and the scenes live in the worker when it renders there, its
+// stand-in forwards the scene calls to session.js on the other side.
+function updateScene(load) {
+  Promise.resolve(load()).then(async numObjects => {
+    if (numObjects !== null) {
+      glMetrics.setNumberOfObjects(numObjects);
+      // loaded files switch to the composite strategy.
+      document.querySelector('.renderStrategy').value = String(await app.getRenderStrategy());
+    }
+  });
+}
+
+// Recordings are saved as .input files, see loadFile in session.js.
+document
+  .querySelector('.recordbutton')
+  .addEventListener('click', async (e) => {
+    if (!await app.isRecording()) {
+      app.startRecording();
+      e.target.textContent = 'Stop Recording';
+      return;
+    }
+    const text = await app.stopRecording();
+    e.target.textContent = 'Record Input';
+    const link = document.createElement('a');
+    link.href = URL.createObjectURL(new Blob([text], { type: 'text/plain' }));
+    link.download = 'session.input';
+    link.click();
+    URL.revokeObjectURL(link.href);
   });
 
 function updatePropertyWidgets() {
@@ -391,8 +599,11 @@ function updatePropertyWidgets() {
 
 function updatePickers() {
   const newPickerType = Number(document.querySelector('.pickerType').value);
-  if (newPickerType === 0) {
+  if (newPickerType === 0 || newPickerType === 3) {
     document.getElementById('selection_color_row').style.display = 'table-row';
+    app.setAreaPicker(newPickerType === 3
+      ? Module.AreaPicker.BoundingVolumeHierarchy
+      : Module.AreaPicker.HardwareSelector);
     app.setPickType(Module.PickType.Area);
   }
   else if (newPickerType === 1) {
@@ -408,9 +619,8 @@ function updatePickers() {
 function updateDatasets() {
   nx = Number(document.querySelector('.nx').value);
   ny = Number(document.querySelector('.ny').value);
-  glMetrics.setNumberOfObjects(app.createDatasets(nx, ny));
-  app.resetView();
-  app.render();
+  const scene = { grid: [nx, ny] };
+  updateScene(() => worker ? app.createScene(scene) : createScene(Module, app, scene));
 }
 
 function updateRepresentation() {
@@ -422,22 +632,70 @@ function updateRepresentation() {
   app.setLineWidth(newLineWidth);
   app.setPointSize(newPointSize);
   app.setRepresentation(newRepValue);
-  app.render();
+  app.requestRender();
   updatePropertyWidgets();
 }
 
-vtkRenderingApplicationExport(Module).then(runtime => {
-  app = new Module.BenchmarkApp();
+// metrics of the last frame, see collectMetrics in session.js.
+let metrics = null;
+
+// Resolves to the app, or to the stand-in of the app rendering in a worker.
+// Both call tick after every frame.
+function startApp(variant) {
+  if (worker) {
+    return startWorkerApp(Module.canvas, variant, useSceneCache, Module, (now, frameMetrics) => {
+      metrics = frameMetrics;
+      glMetrics.tick(now);
+    }).then(app => {
+      markStartup('worker ready');
+      glMetrics.setThreadingInfo('single-threaded, rendering in a worker');
+      return app;
+    });
+  }
+  prefetchModule(variant);
+  return loadScript(`${variant}vtkRenderingApplication.js`).then(() => {
+    markStartup('script loaded');
+    return vtkRenderingApplicationExport(Module);
+  }).then(runtime => {
+    const app = new Module.BenchmarkApp();
+    global.tick = (now) => {
+      metrics = collectMetrics(Module, app, now);
+      glMetrics.tick(now);
+    };
+    glMetrics.setThreadingInfo(app.isMultithreaded()
+      ? `multithreaded, ${app.getNumberOfThreads()} workers (${app.getSMPBackend()})`
+      : 'single-threaded');
+    return app;
+  });
+}
+
+const variant = selectVariant();
+const worker = selectWorker(variant);
+startApp(variant).then(benchmarkApp => {
+  app = benchmarkApp;
   console.log('App created');
   // expose to the console for easy access
   global.app = app;
-  global.tick = glMetrics.tick;
+  glMetrics.setFrameStatisticsProvider(() => metrics.frameStatistics);
+  glMetrics.setFrameHistogramProvider(() => metrics.frameHistogram);
+  glMetrics.setFrameQualityProvider(() => metrics.frameQualities);
+  glMetrics.setTranslucencyStatisticsProvider(() => metrics.translucencyStatistics);
+  glMetrics.setViewStatisticsProvider(() => metrics.viewStatistics);
+  glMetrics.setMemoryStatsProvider(() => metrics.memory);
+  glMetrics.setStartupTimesProvider(() => startupTimes.concat(metrics.startupTimes)
+    .sort((a, b) => a.milliseconds - b.milliseconds));
+  glMetrics.setCullingStatsProvider(() => metrics.culling);
+  glMetrics.setRenderStatsProvider(() => metrics.renders);
+  glMetrics.setConstructionStatsProvider(() => metrics.construction);
+  glMetrics.setPrimitiveCountsProvider(() => metrics.primitiveCounts);
   // -----------------------------------------------------------
   // Initialize application
   // -----------------------------------------------------------
   app.initialize();
   app.setScrollSensitivity(scrollSensitivity);
   app.setSelectedBlockColor(0.952, 0.937, 0.368);
+  // large scenes are built over several frames, the page stays responsive.
+  app.setConstructionBudget(8);
   updateDatasets();
   updateRepresentation();
   updatePickers();
@@ -446,9 +704,9 @@ vtkRenderingApplicationExport(Module).then(runtime => {
     window.dispatchEvent(new Event('resize'));
   }, 0);
   // focus on the canvas to grab keyboard inputs.
-  canvas.setAttribute('tabindex', '0');
+  Module.canvas.setAttribute('tabindex', '0');
   // grab focus when the render window region receives mouse clicks.
-  canvas.addEventListener('click', () => canvas.focus());
-  // starts processing events on browser main thread.
+  Module.canvas.addEventListener('click', () => Module.canvas.focus());
+  // starts processing events on the thread the app runs on.
   app.run();
 })
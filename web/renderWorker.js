@@ -0,0 +1,96 @@
+// Runs the wasm module and its WebGL2 context in a dedicated worker, on an
+// OffscreenCanvas transferred by the page, so that the work of the page does
+// not delay the frames. See workerApp.js for the page side.
+//
+// Messages from the page:
+//   { type: 'init', canvas, variant, useSceneCache } first and once.
+//   { type: 'call', id, method, args } calls a method of the app, or
+//     createScene and loadFile of session.js. Enum values are passed as
+//     { enum, name }. Answered with { type: 'result', id, value } or
+//     { type: 'result', id, error }.
+//   { type: 'input', text } dispatches lines of an input recording.
+// Messages to the page:
+//   { type: 'ready', enums, timeOrigin } once the app is created.
+//   { type: 'tick', now, metrics } after every frame, see collectMetrics.
+import { collectMetrics, createScene, loadFile, setUseSceneCache } from './session';
+
+// enums of the bindings, the page refers to their values by name.
+const EnumNames = [
+  'AreaPicker',
+  'FramePhase',
+  'LayerID',
+  'PickType',
+  'RenderQuality',
+  'RenderStrategy',
+  'StartupPhase',
+  'TranslucencyTechnique',
+];
+
+const Module = {
+  print: (text) => { console.log('stdout: ' + text); },
+  printErr: (text) => { console.log('stderr: ' + text); },
+};
+let app = null;
+
+const sessionMethods = {
+  createScene: (scene) => createScene(Module, app, scene),
+  loadFile: (file) => loadFile(Module, app, file),
+};
+
+function toArgument(value) {
+  return value && value.enum ? Module[value.enum][value.name] : value;
+}
+
+async function call({ id, method, args }) {
+  const values = args.map(toArgument);
+  try {
+    const value = sessionMethods[method]
+      ? await sessionMethods[method](...values)
+      : app[method](...values);
+    postMessage({ type: 'result', id, value });
+  } catch (error) {
+    // the event loop of the interactor unwinds the stack when it starts.
+    if (error === 'unwind') {
+      postMessage({ type: 'result', id });
+      return;
+    }
+    postMessage({ type: 'result', id, error: String(error) });
+    throw error;
+  }
+}
+
+async function initialize({ canvas, variant, useSceneCache }) {
+  setUseSceneCache(useSceneCache);
+  canvas.addEventListener('webglcontextlost', (e) => {
+    console.error('WebGL context lost. You will need to reload the page.');
+    e.preventDefault();
+  });
+  Module.canvas = canvas;
+  // the glue code looks files up next to the worker script.
+  Module.locateFile = (path) => `${variant}${path}`;
+  // the render window creates its context on the #canvas selector.
+  Module.preRun = [() => { Module.specialHTMLTargets['#canvas'] = canvas; }];
+  importScripts(`${variant}vtkRenderingApplication.js`);
+  await vtkRenderingApplicationExport(Module);
+  app = new Module.BenchmarkApp();
+  self.tick = (now) => {
+    postMessage({ type: 'tick', now, metrics: collectMetrics(Module, app, now) });
+  };
+  const enums = {};
+  EnumNames.forEach(name => {
+    enums[name] = Object.keys(Module[name]).filter(key => key !== 'values');
+  });
+  postMessage({ type: 'ready', enums, timeOrigin: performance.timeOrigin });
+}
+
+// calls that arrive while the module loads wait for it.
+let ready = null;
+self.onmessage = ({ data }) => {
+  if (data.type === 'init') {
+    ready = initialize(data);
+  } else if (data.type === 'call') {
+    ready.then(() => call(data));
+  } else if (data.type === 'input') {
+    ready.then(() => app.dispatchInput(data.text));
+  }
+};
@@ -0,0 +1,58 @@
+// Scene snapshots written by BenchmarkApp::WriteSceneCache, kept in
+// IndexedDB between page loads. Only the most recent ones are kept, a large
+// grid takes tens of megabytes.
+const DatabaseName = 'vtkwasmbenchmark';
+const StoreName = 'scenes';
+const MaxEntries = 4;
+
+let database = null;
+
+function request(req) {
+  return new Promise((resolve, reject) => {
+    req.onsuccess = () => resolve(req.result);
+    req.onerror = () => reject(req.error);
+  });
+}
+
+function openDatabase() {
+  if (!database) {
+    const req = indexedDB.open(DatabaseName, 1);
+    req.onupgradeneeded = () => req.result.createObjectStore(StoreName);
+    database = request(req);
+  }
+  return database;
+}
+
+// Returns the Blob stored for `key`, null when there is none or when the
+// browser has no usable storage.
+export async function getCachedScene(key) {
+  try {
+    const db = await openDatabase();
+    const entry = await request(
+      db.transaction(StoreName).objectStore(StoreName).get(key));
+    return entry ? entry.blob : null;
+  } catch (error) {
+    console.warn('Scene cache unavailable', error);
+    return null;
+  }
+}
+
+export async function putCachedScene(key, blob) {
+  try {
+    const db = await openDatabase();
+    const store = db.transaction(StoreName, 'readwrite').objectStore(StoreName);
+    // blobs are read lazily, listing the entries does not load them.
+    const keys = await request(store.getAllKeys());
+    const entries = await request(store.getAll());
+    const stale = keys
+      .map((k, i) => ({ key: k, time: entries[i].time }))
+      .filter(entry => entry.key !== key)
+      .sort((a, b) => a.time - b.time);
+    for (const entry of stale.slice(0, Math.max(stale.length - MaxEntries + 1, 0))) {
+      store.delete(entry.key);
+    }
+    await request(store.put({ time: Date.now(), blob }, key));
+  } catch (error) {
+    console.warn('Cannot store the scene', error);
+  }
+}
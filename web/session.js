@@ -0,0 +1,191 @@
+// Scene loading and metrics of a running app, shared by the page and the
+// render worker, whichever of them runs the wasm module. Nothing in here
+// touches the DOM.
+import { getCachedScene, putCachedScene } from './sceneCache';
+import { takePrimitiveCounts } from './gl/primitives';
+
+// Generated scenes are stored in the browser once they are built, and
+// restored from there the next time, see sceneCache.js.
+let useSceneCache = true;
+let sceneGeneration = 0;
+
+function setUseSceneCache(use) {
+  useSceneCache = use;
+}
+
+function storeSceneWhenBuilt(Module, app, key, generation) {
+  if (generation !== sceneGeneration) {
+    return;
+  }
+  if (app.isConstructionPending()) {
+    setTimeout(() => storeSceneWhenBuilt(Module, app, key, generation), 250);
+    return;
+  }
+  const size = app.writeSceneCache();
+  if (size > 0) {
+    // the Blob copies the bytes, the snapshot is released right away.
+    const ptr = app.getSceneCacheData();
+    putCachedScene(key, new Blob([Module.HEAPU8.subarray(ptr, ptr + size)]));
+  }
+  app.releaseSceneCache();
+}
+
+// Copies a stored snapshot into the wasm heap, the app points the arrays of
+// the blocks into it. `create` builds the scene when nothing usable is stored.
+// Returns the number of objects, null when a newer scene was requested
+// meanwhile.
+async function createCachedScene(Module, app, key, create) {
+  const generation = ++sceneGeneration;
+  const blob = useSceneCache ? await getCachedScene(key) : null;
+  const bytes = blob ? new Uint8Array(await blob.arrayBuffer()) : null;
+  if (generation !== sceneGeneration) {
+    return null;
+  }
+  let numObjects = 0;
+  if (bytes) {
+    const ptr = Module._malloc(bytes.length);
+    Module.HEAPU8.set(bytes, ptr);
+    numObjects = app.loadSceneCacheFromBinary(ptr, bytes.length);
+    console.log(`Restored ${key} in ${app.getLoadTime().toFixed(1)} ms`);
+  }
+  if (numObjects === 0) {
+    numObjects = create();
+    if (useSceneCache) {
+      storeSceneWhenBuilt(Module, app, key, generation);
+    }
+  }
+  app.resetView();
+  app.requestRender();
+  return numObjects;
+}
+
+// `scene` is { grid: [nx, ny] } or the { text } of a scene description, so
+// that it can be posted to the worker.
+function createScene(Module, app, scene) {
+  if (scene.text !== undefined) {
+    return createCachedScene(Module, app, `scene ${scene.text}`,
+      () => app.loadScene(scene.text));
+  }
+  const [nx, ny] = scene.grid;
+  return createCachedScene(Module, app, `grid ${nx}x${ny}`,
+    () => app.createDatasets(nx, ny));
+}
+
+// Recordings are saved as .input files, loading one replays it at 60 steps
+// per second of recorded time, one frame per step. Other files are streamed
+// into the wasm heap chunk by chunk, so that the whole file is never held by
+// JS and by the wasm module at the same time. The app takes ownership of the
+// buffer. Returns the number of objects, null when no scene was loaded.
+async function loadFile(Module, app, file) {
+  if (file.name.toLowerCase().endsWith('.input')) {
+    if (app.startReplay(await file.text(), 1000 / 60) > 0) {
+      app.playReplay();
+    }
+    return null;
+  }
+  if (file.name.toLowerCase().endsWith('.scene')) {
+    // scene descriptions are small text files, generated by the app.
+    return createScene(Module, app, { text: await file.text() });
+  }
+  ++sceneGeneration;
+  const ptr = Module._malloc(file.size);
+  if (!ptr) {
+    console.error(`Not enough memory to load ${file.name} (${file.size} bytes)`);
+    return null;
+  }
+  let offset = 0;
+  const reader = file.stream().getReader();
+  for (;;) {
+    const { done, value } = await reader.read();
+    if (done) {
+      break;
+    }
+    Module.HEAPU8.set(value, ptr + offset);
+    offset += value.length;
+  }
+  const numObjects = app.loadFileFromBinary(ptr, file.size, file.name);
+  console.log(`Loaded ${app.getLoadedBytes()} bytes in ${app.getLoadTime().toFixed(1)} ms`);
+  app.resetView();
+  app.requestRender();
+  return numObjects;
+}
+
+// Frames per bin of the total frame time, in equal bins from 0 to `range`
+// ms. Slower frames are counted in the last bin.
+const histogramBins = 16;
+function frameTimeHistogram(Module, app, range) {
+  const total = Module.FramePhase.Total.value;
+  // Total is the last phase of a frame.
+  const stride = total + 1;
+  const samples = app.getFrameTimings();
+  const binWidth = range > 0 ? range / histogramBins : 1;
+  const counts = new Array(histogramBins).fill(0);
+  for (let i = total; i < samples.length; i += stride) {
+    ++counts[Math.min(histogramBins - 1, Math.floor(samples[i] / binWidth))];
+  }
+  return { counts, binWidth };
+}
+
+// the statistics walk the recent frames and the memory use walks the blocks.
+// they are refreshed once per second, as often as the panel shows them, see
+// framesWindow in gl/metrics.js.
+const statisticsInterval = 1000; // ms
+let statistics = null;
+let statisticsTime = -Infinity;
+
+function collectStatistics(Module, app) {
+  const appPhases = {
+    'app constructed': Module.StartupPhase.Constructed,
+    'app initialized': Module.StartupPhase.Initialized,
+    'scene ready': Module.StartupPhase.SceneReady,
+    'first frame': Module.StartupPhase.FirstFrame,
+  };
+  const frameStatistics = app.getFrameTimingStatistics(Module.FramePhase.Total);
+  return {
+    frameStatistics,
+    frameHistogram: frameTimeHistogram(Module, app, frameStatistics.p99),
+    translucencyStatistics:
+      app.getFrameTimingStatistics(Module.FramePhase.Translucency),
+    frameQualities: app.getFrameQualities(),
+    viewStatistics: Array.from(
+      { length: app.getNumberOfViews() }, (_, view) => app.getViewTimingStatistics(view)),
+    memory: app.getMemoryStats(),
+    startupTimes: Object.entries(appPhases)
+      .map(([name, phase]) => ({ name, milliseconds: app.getStartupTime(phase) }))
+      .filter(phase => phase.milliseconds >= 0),
+  };
+}
+
+// Values shown by the metrics panel after a frame, as plain data that can be
+// posted from the worker. Startup times are in ms since this thread started.
+function collectMetrics(Module, app, now) {
+  if (now - statisticsTime >= statisticsInterval) {
+    statistics = collectStatistics(Module, app);
+    statisticsTime = now;
+  }
+  return {
+    ...statistics,
+    culling: {
+      culled: app.getNumberOfCulledBlocks(),
+      milliseconds: app.getCullingTime(),
+    },
+    renders: {
+      renders: app.getNumberOfRenders(),
+      requests: app.getNumberOfRenderRequests(),
+      coalesced: app.getNumberOfCoalescedRenders(),
+      skipped: app.getNumberOfSkippedRenders(),
+    },
+    construction: {
+      progress: app.getConstructionProgress(),
+      frameTime: app.getConstructionFrameTime(),
+    },
+    primitiveCounts: takePrimitiveCounts(),
+  };
+}
+
+export {
+  collectMetrics,
+  createScene,
+  loadFile,
+  setUseSceneCache,
+};
@@ -0,0 +1,145 @@
+// Page side of renderWorker.js. Hands the canvas over to the worker, forwards
+// its input as lines of an input recording, see src/InputRecording.h, and
+// stands in for the app: every method posts a call and returns a promise of
+// its result.
+
+const MouseButtons = ['Left', 'Middle', 'Right'];
+
+// X keysyms of the keys whose name is not the character, the interactor
+// styles of VTK expect these.
+const KeySyms = {
+  ' ': 'space',
+  '#': 'numbersign',
+  '-': 'minus',
+  ArrowLeft: 'Left',
+  ArrowRight: 'Right',
+  ArrowUp: 'Up',
+  ArrowDown: 'Down',
+  Enter: 'Return',
+  Escape: 'Escape',
+  Shift: 'Shift_L',
+  Control: 'Control_L',
+  Alt: 'Alt_L',
+};
+
+function modifiers(e) {
+  return (e.ctrlKey ? 1 : 0) | (e.shiftKey ? 2 : 0) | (e.altKey ? 4 : 0);
+}
+
+// Posts the input of the canvas to the worker. Positions are in device
+// pixels from the bottom left corner, like the render window.
+function forwardInput(canvas, post) {
+  const position = (e) => {
+    const ratio = window.devicePixelRatio;
+    const x = Math.floor(e.offsetX * ratio);
+    const y = Math.floor((canvas.clientHeight - e.offsetY) * ratio) - 1;
+    return `${x} ${y} ${modifiers(e)}`;
+  };
+  const mouse = (name, e, repeat = 0) => {
+    post(`0 ${name} ${position(e)} ${repeat} 0 -`);
+  };
+  // pointer events carry no click count. a press of the same button soon
+  // after the previous one is a double click for the interactor.
+  const doubleClickDelay = 500; // ms
+  let lastPress = { button: -1, time: -Infinity };
+  const key = (names, e) => {
+    const keyCode = e.key.length === 1 && e.key.charCodeAt(0) < 256 ? e.key.charCodeAt(0) : 0;
+    const keySym = KeySyms[e.key] || (/^\S+$/.test(e.key) ? e.key : '-');
+    post(names.map(name => `0 ${name} 0 0 ${modifiers(e)} 0 ${keyCode} ${keySym}`).join('\n'));
+  };
+  canvas.addEventListener('pointerdown', (e) => {
+    if (e.button < MouseButtons.length) {
+      canvas.setPointerCapture(e.pointerId);
+      const repeat = e.button === lastPress.button &&
+        e.timeStamp - lastPress.time < doubleClickDelay ? 1 : 0;
+      // a third press starts over.
+      lastPress = repeat ? { button: -1, time: -Infinity } : { button: e.button, time: e.timeStamp };
+      mouse(`${MouseButtons[e.button]}ButtonPressEvent`, e, repeat);
+    }
+  });
+  canvas.addEventListener('pointerup', (e) => {
+    if (e.button < MouseButtons.length) {
+      mouse(`${MouseButtons[e.button]}ButtonReleaseEvent`, e);
+    }
+  });
+  canvas.addEventListener('pointermove', (e) => mouse('MouseMoveEvent', e));
+  canvas.addEventListener('pointerenter', (e) => mouse('EnterEvent', e));
+  canvas.addEventListener('pointerleave', (e) => mouse('LeaveEvent', e));
+  canvas.addEventListener('wheel', (e) => {
+    e.preventDefault();
+    mouse(e.deltaY < 0 ? 'MouseWheelForwardEvent' : 'MouseWheelBackwardEvent', e);
+  }, { passive: false });
+  canvas.addEventListener('contextmenu', (e) => e.preventDefault());
+  canvas.addEventListener('keydown', (e) => {
+    key(e.key.length === 1 ? ['KeyPressEvent', 'CharEvent'] : ['KeyPressEvent'], e);
+  });
+  canvas.addEventListener('keyup', (e) => key(['KeyReleaseEvent'], e));
+}
+
+// Starts the worker on `canvas` and resolves to the stand-in of its app once
+// the app exists. `enums` receives the enums of the bindings, their values
+// are passed to the worker by name. `onTick` receives the metrics of every
+// frame, with the startup times on the clock of the page.
+function startWorkerApp(canvas, variant, useSceneCache, enums, onTick) {
+  const worker = new Worker(new URL('./renderWorker.js', import.meta.url));
+  const offscreen = canvas.transferControlToOffscreen();
+  worker.postMessage({ type: 'init', canvas: offscreen, variant, useSceneCache }, [offscreen]);
+
+  let nextCallId = 0;
+  const calls = new Map();
+  const app = new Proxy({}, {
+    get: (_, method) => {
+      // not a promise itself.
+      if (method === 'then') {
+        return undefined;
+      }
+      return (...args) => new Promise((resolve, reject) => {
+        const id = nextCallId++;
+        calls.set(id, { resolve, reject });
+        worker.postMessage({ type: 'call', id, method, args });
+      });
+    },
+  });
+
+  // the window size in device pixels, the worker cannot read it.
+  const resize = () => {
+    const ratio = window.devicePixelRatio;
+    canvas.style.width = `${window.innerWidth}px`;
+    canvas.style.height = `${window.innerHeight}px`;
+    const width = Math.floor(window.innerWidth * ratio);
+    const height = Math.floor(window.innerHeight * ratio);
+    worker.postMessage({ type: 'input', text: `0 size ${width} ${height}` });
+    app.requestRender();
+  };
+
+  return new Promise((resolve) => {
+    let timeOffset = 0;
+    worker.onmessage = ({ data }) => {
+      if (data.type === 'result') {
+        const call = calls.get(data.id);
+        calls.delete(data.id);
+        if (data.error !== undefined) {
+          call.reject(new Error(data.error));
+        } else {
+          call.resolve(data.value);
+        }
+      } else if (data.type === 'tick') {
+        data.metrics.startupTimes.forEach(phase => { phase.milliseconds += timeOffset; });
+        onTick(data.now, data.metrics);
+      } else if (data.type === 'ready') {
+        timeOffset = data.timeOrigin - performance.timeOrigin;
+        Object.entries(data.enums).forEach(([name, values]) => {
+          enums[name] = {};
+          values.forEach(value => { enums[name][value] = { enum: name, name: value }; });
+        });
+        forwardInput(canvas, text => worker.postMessage({ type: 'input', text }));
+        window.addEventListener('resize', resize);
+        resolve(app);
+      }
+    };
+  });
+}
+
+export {
+  startWorkerApp,
+};
@@ -67,8 +67,29 @@ module.exports = {
             __dirname, "src", "build-emscripten", "vtkRenderingApplication.wasm"
           ),
           to: path.join(__dirname, "dist", "vtkRenderingApplication.wasm")
+        },
+        // the multithreaded variant is optional.
+        {
+          context: path.join(__dirname, "src", "build-emscripten-threads"),
+          from: "vtkRenderingApplication.*",
+          to: path.join(__dirname, "dist", "threads"),
+          noErrorOnMissing: true
+        },
+        // so is the startup-optimized one, built along with the single-threaded one.
+        {
+          context: path.join(__dirname, "src", "build-emscripten", "startup"),
+          from: "vtkRenderingApplication.*",
+          to: path.join(__dirname, "dist", "startup"),
+          noErrorOnMissing: true
         }
       ],
     })
   ],
+  // SharedArrayBuffer, and with it the threads, needs cross-origin isolation.
+  devServer: {
+    headers: {
+      "Cross-Origin-Opener-Policy": "same-origin",
+      "Cross-Origin-Embedder-Policy": "require-corp",
+    },
+  },
 }